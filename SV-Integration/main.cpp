@@ -1,8 +1,152 @@
-#include <stdio.h>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <vector>
 #include <svdpi.h>
 
-extern "C" int test_func() {
+#include "generator.h"
+#include "mix.h"
+#include "shard.h"
 
-    return 1;
+//-------------------------------------------------
+// SystemVerilog DPI-C Interface
+//
+// One generator stream per simulation, configured with the gen_rand_set_*
+// calls and read in large batches with gen_rand_instr_batch, so the
+// simulator crosses the DPI boundary once per batch rather than once per
+// instruction. For a given seed the stream matches the CLI's output.
+//
+// SystemVerilog side:
+//   import "DPI-C" function void gen_rand_set_seed(input longint seed);
+//   import "DPI-C" function void gen_rand_set_rng(input int kind);
+//   import "DPI-C" function void gen_rand_set_instr_mask(input longint mask);
+//   import "DPI-C" function int  gen_rand_load_mix(input string path);
+//   import "DPI-C" function int  gen_rand_instr_batch(output bit [31:0] words[], input int n);
+//   import "DPI-C" function longint gen_rand_wall_time_ns();
+//-------------------------------------------------
 
-}
\ No newline at end of file
+static GenConfig dpi_config;
+static std::unique_ptr<ShardedStream> dpi_stream;
+
+// Restart the stream from instruction 0 with the current configuration
+static void restart_stream() {
+
+    dpi_stream = std::make_unique<ShardedStream>(dpi_config);
+
+}
+
+
+
+extern "C" void gen_rand_set_seed(int64_t seed) {
+
+    dpi_config.seed = static_cast<uint64_t>(seed);
+    restart_stream();
+
+}
+
+
+
+// 0 = xoshiro256**, 1 = Philox4x32-10
+extern "C" void gen_rand_set_rng(int kind) {
+
+    dpi_config.rng = (kind == 1) ? RngKind::PHILOX : RngKind::XOSHIRO;
+    restart_stream();
+
+}
+
+
+
+// Bit i enables instr_table[i]
+extern "C" void gen_rand_set_instr_mask(int64_t mask) {
+
+    dpi_config.instr_mask = static_cast<uint64_t>(mask) & ALL_INSTRS;
+    restart_stream();
+
+}
+
+
+
+// Load instruction weights from a mix file (see mix.h); returns 0 on
+// success, or -1 after printing the error and keeping the previous mix
+extern "C" int gen_rand_load_mix(const char* path) {
+
+    InstrWeights weights = uniform_weights();
+
+    try {
+
+        load_mix_file(path, weights);
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "gen_rand_load_mix: " << e.what() << "\n";
+        return -1;
+
+    }
+
+    dpi_config.weights = weights;
+    restart_stream();
+    return 0;
+
+}
+
+
+
+// Fill up to n elements of buf (bounded by its size) and return the count
+extern "C" int gen_rand_instr_batch(const svOpenArrayHandle buf, int n) {
+
+    if (!dpi_stream) {
+
+        restart_stream();
+
+    }
+
+    int size = svSize(buf, 1);
+
+    if (n > size) {
+
+        n = size;
+
+    }
+
+    if (n <= 0) {
+
+        return 0;
+
+    }
+
+    // Write straight into the simulator's array when its storage is a plain
+    // C array of 32-bit words; otherwise stage and copy element by element
+    if (uint32_t* direct = static_cast<uint32_t*>(svGetArrayPtr(buf))) {
+
+        return static_cast<int>(dpi_stream->generate(direct, static_cast<size_t>(n)));
+
+    }
+
+    static std::vector<uint32_t> staging;
+    staging.resize(static_cast<size_t>(n));
+
+    int written = static_cast<int>(dpi_stream->generate(staging.data(), staging.size()));
+    int low = svLow(buf, 1);
+
+    for (int i = 0; i < written; ++i) {
+
+        svBitVecVal word = staging[static_cast<size_t>(i)];
+        svPutBitArrElem1VecVal(buf, &word, low + i);
+
+    }
+
+    return written;
+
+}
+
+
+
+// Host wall-clock time, for throughput measurements in the testbench
+extern "C" int64_t gen_rand_wall_time_ns() {
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+}
@@ -1,11 +1,74 @@
+// Drives a 1 GHz "fetch" loop from the DPI generator. Each clock consumes
+// one instruction from a local buffer, which is refilled with a single
+// gen_rand_instr_batch call every BATCH instructions. At the end the
+// testbench reports throughput per host second; per simulated second it is
+// one instruction per clock by construction, so it is not reported.
 module test;
 
-    import "DPI" function int test_func();
-    int x;
+    timeunit 1ns;
+    timeprecision 1ps;
+
+    import "DPI-C" function void gen_rand_set_seed(input longint seed);
+    import "DPI-C" function void gen_rand_set_rng(input int kind);
+    import "DPI-C" function void gen_rand_set_instr_mask(input longint mask);
+    import "DPI-C" function int  gen_rand_load_mix(input string path);
+    import "DPI-C" function int  gen_rand_instr_batch(output bit [31:0] words[], input int n);
+    import "DPI-C" function longint gen_rand_wall_time_ns();
+
+    parameter int     BATCH = 4096;
+    parameter longint TOTAL = 10_000_000;
+    parameter longint SEED  = 1;
+
+    bit [31:0] words[];
+    bit [31:0] instr;
+    bit        clk = 0;
+    longint    consumed = 0;
+    longint    dpi_calls = 0;
+    int        filled = 0;
+    int        index = 0;
+    string     mix_file;
+
+    always #0.5ns clk = ~clk;
 
     initial begin
-        x = test_func();
-        $display(x);
+
+        longint start_ns;
+        longint elapsed_ns;
+
+        words = new[BATCH];
+        gen_rand_set_seed(SEED);
+
+        // Optional instruction mix: +mix=<file>
+        if ($value$plusargs("mix=%s", mix_file) && gen_rand_load_mix(mix_file) != 0)
+            $fatal(1, "cannot load mix file %s", mix_file);
+
+        start_ns = gen_rand_wall_time_ns();
+
+        while (consumed < TOTAL) begin
+
+            @(posedge clk);
+
+            // Refill the buffer with one DPI call
+            if (index == filled) begin
+                filled = gen_rand_instr_batch(words, BATCH);
+                index = 0;
+                dpi_calls++;
+            end
+
+            instr = words[index];
+            index++;
+            consumed++;
+
+        end
+
+        elapsed_ns = gen_rand_wall_time_ns() - start_ns;
+
+        $display("instructions:            %0d", consumed);
+        $display("dpi calls:               %0d", dpi_calls);
+        $display("last instruction:        %08h", instr);
+        $display("instr / host sec:        %0.3e", consumed / (elapsed_ns / 1.0e9));
+        $finish;
+
     end
 
-endmodule: test
\ No newline at end of file
+endmodule: test
@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_encode.h"
+#include "encoders.h"
+#include "generator.h"
+#include "output.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Generator Benchmarks
+//
+// Measures instructions/s and ns/instruction for each generator family,
+// the batch encoders at each SIMD level against the scalar encoders, each
+// output format (generation included, written to a scratch file) and
+// each thread count. Every case keeps its best of --repeats runs. Results
+// are printed as JSON, one result per line in a fixed order, so a saved run
+// can serve as the baseline for --baseline. Baselines are only meaningful
+// on the machine that produced them.
+//-------------------------------------------------
+
+struct BenchResult {
+    std::string name;
+    double instr_per_sec;
+};
+
+// Generator families; U/J covers lui, auipc, jal and jalr
+struct Family {
+    const char* name;
+    uint64_t class_mask;    // bit = InstrClass
+};
+
+static const Family families[] = {
+    {"branch",    1u << static_cast<int>(InstrClass::BRANCH)},
+    {"load",      1u << static_cast<int>(InstrClass::LOAD)},
+    {"store",     1u << static_cast<int>(InstrClass::STORE)},
+    {"immediate", 1u << static_cast<int>(InstrClass::IMMEDIATE)},
+    {"shift",     1u << static_cast<int>(InstrClass::SHIFT)},
+    {"register",  1u << static_cast<int>(InstrClass::REGISTER)},
+    {"upper_jump", (1u << static_cast<int>(InstrClass::UPPER)) | (1u << static_cast<int>(InstrClass::JUMP)) |
+                   (1u << static_cast<int>(InstrClass::JUMP_REG))}
+};
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+// Best wall time of fn over repeats runs
+template <typename Fn>
+static double best_seconds(int repeats, Fn fn) {
+
+    double best = INFINITY;
+
+    for (int r = 0; r < repeats; ++r) {
+
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    }
+
+    return best;
+
+}
+
+
+
+static uint64_t family_mask(const Family& family) {
+
+    uint64_t mask = 0;
+
+    for (uint32_t id = 0; id < INSTR_COUNT; ++id) {
+
+        if ((family.class_mask >> static_cast<int>(instr_table[id].instr_class)) & 1) {
+
+            mask |= uint64_t{1} << id;
+
+        }
+
+    }
+
+    return mask;
+
+}
+
+
+
+// Generate count instructions in shard-sized chunks and write them in the
+// given format, as the CLI does with one thread
+static void generate_and_write(const GenConfig& config, size_t count, const char* format, const char* path) {
+
+    std::vector<uint32_t> words(SHARD_SIZE);
+
+    if (std::strcmp(format, "text") == 0) {
+
+        // Assembly and hex per instruction, as the CLI's text output
+        std::vector<InstrRecord> records(SHARD_SIZE);
+        AsmWriter writer(path);
+
+        for (size_t done = 0; done < count; done += SHARD_SIZE) {
+
+            size_t n = std::min(SHARD_SIZE, count - done);
+            Rng rng(config.rng, config.seed, done / SHARD_SIZE);
+            generate_records(records.data(), n, config, rng);
+            writer.write(records.data(), n);
+
+        }
+
+        writer.finish();
+        return;
+
+    }
+
+    OutputFormat output_format;
+    parse_output_format(format, output_format);
+    std::unique_ptr<OutputWriter> writer = open_output(output_format, path);
+
+    for (size_t done = 0; done < count; done += SHARD_SIZE) {
+
+        size_t n = generate_sharded(words.data(), std::min(SHARD_SIZE, count - done), config, 1, done / SHARD_SIZE);
+        writer->write(words.data(), n);
+
+    }
+
+    writer->finish();
+
+}
+
+
+
+// Read "name" / "instr_per_sec" pairs from a file this program wrote
+static std::vector<BenchResult> load_baseline(const char* path) {
+
+    std::ifstream file(path);
+    std::vector<BenchResult> results;
+    std::string line;
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": cannot open");
+
+    }
+
+    while (std::getline(file, line)) {
+
+        size_t name = line.find("\"name\": \"");
+        size_t rate = line.find("\"instr_per_sec\": ");
+
+        if (name == std::string::npos || rate == std::string::npos) {
+
+            continue;
+
+        }
+
+        name += std::strlen("\"name\": \"");
+        results.push_back({line.substr(name, line.find('"', name) - name),
+                           std::strtod(line.c_str() + rate + std::strlen("\"instr_per_sec\": "), nullptr)});
+
+    }
+
+    return results;
+
+}
+
+
+
+int main(int argc, char* argv[]) {
+
+    // Parse command line options
+    size_t count = size_t{1} << 22;
+    int repeats = 3;
+    const char* baseline_path = nullptr;
+    double tolerance = 0.10;
+    const char* scratch_path = "bench_scratch.tmp";
+
+    for (int i = 1; i < argc; ++i) {
+
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+
+            count = std::strtoull(argv[++i], nullptr, 0);
+
+        } else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+
+            repeats = std::max(1, std::atoi(argv[++i]));
+
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+
+            baseline_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+
+            tolerance = std::strtod(argv[++i], nullptr) / 100.0;
+
+        } else if (std::strcmp(argv[i], "--scratch") == 0 && i + 1 < argc) {
+
+            scratch_path = argv[++i];
+
+        } else {
+
+            std::cerr << "usage: " << argv[0] << " [--count N] [--repeats R] [--scratch PATH]\n"
+                      << "       [--baseline FILE [--tolerance PERCENT]]\n";
+            return 1;
+
+        }
+
+    }
+
+    std::vector<BenchResult> results;
+    std::vector<uint32_t> words(count);
+    GenConfig config;
+    config.seed = 1;
+
+    // Generator families, machine words only, one thread
+    for (const Family& family : families) {
+
+        GenConfig family_config = config;
+        family_config.instr_mask = family_mask(family);
+
+        double seconds = best_seconds(repeats, [&]() {
+
+            Rng rng(family_config.rng, family_config.seed);
+            generate_batch(words.data(), count, family_config, rng);
+
+        });
+
+        results.push_back({std::string("family/") + family.name, count / seconds});
+
+    }
+
+    // Field arrays encoded in all six formats: the scalar encode_*_type
+    // loop, then each batch level the build and CPU support, which must
+    // match the loop bit for bit
+    std::vector<uint32_t> funct7(count), funct3(count), rd(count), rs1(count), rs2(count), imm(count), opcode(count);
+    std::vector<uint32_t> expected(6 * count), actual(6 * count);
+    Xoshiro256ss field_rng(config.seed);
+
+    for (size_t i = 0; i < count; ++i) {
+
+        uint64_t word = field_rng.next();
+        funct7[i] = static_cast<uint32_t>(word) & 0x7F;
+        funct3[i] = static_cast<uint32_t>(word >> 7) & 0x7;
+        rd[i] = static_cast<uint32_t>(word >> 10) & 0x1F;
+        rs1[i] = static_cast<uint32_t>(word >> 15) & 0x1F;
+        rs2[i] = static_cast<uint32_t>(word >> 20) & 0x1F;
+        opcode[i] = static_cast<uint32_t>(word >> 25) & 0x7F;
+        imm[i] = static_cast<uint32_t>(word >> 32);
+
+    }
+
+    double loop_seconds = best_seconds(repeats, [&]() {
+
+        for (size_t i = 0; i < count; ++i) {
+
+            expected[i] = encode_R_type(funct7[i], rs2[i], rs1[i], funct3[i], rd[i], opcode[i]);
+            expected[count + i] = encode_I_type(imm[i], rs1[i], funct3[i], rd[i], opcode[i]);
+            expected[2 * count + i] = encode_S_type(imm[i], rs2[i], rs1[i], funct3[i], opcode[i]);
+            expected[3 * count + i] = encode_B_type(imm[i], rs2[i], rs1[i], funct3[i], opcode[i]);
+            expected[4 * count + i] = encode_U_type(imm[i], rd[i], opcode[i]);
+            expected[5 * count + i] = encode_J_type(imm[i], rd[i], opcode[i]);
+
+        }
+
+    });
+
+    results.push_back({"encode/loop", 6 * count / loop_seconds});
+
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+
+        const BatchEncoders* enc = batch_encoders_for(level);
+
+        if (enc == nullptr) {
+
+            continue;
+
+        }
+
+        double seconds = best_seconds(repeats, [&]() {
+
+            uint32_t* out = actual.data();
+            enc->encode_R(out, count, funct7.data(), rs2.data(), rs1.data(), funct3.data(), rd.data(), opcode.data());
+            enc->encode_I(out + count, count, imm.data(), rs1.data(), funct3.data(), rd.data(), opcode.data());
+            enc->encode_S(out + 2 * count, count, imm.data(), rs2.data(), rs1.data(), funct3.data(), opcode.data());
+            enc->encode_B(out + 3 * count, count, imm.data(), rs2.data(), rs1.data(), funct3.data(), opcode.data());
+            enc->encode_U(out + 4 * count, count, imm.data(), rd.data(), opcode.data());
+            enc->encode_J(out + 5 * count, count, imm.data(), rd.data(), opcode.data());
+
+        });
+
+        if (actual != expected) {
+
+            std::cerr << "error: " << simd_level_name(level) << " batch encoders differ from the scalar encoders\n";
+            return 1;
+
+        }
+
+        results.push_back({std::string("encode/") + simd_level_name(level), 6 * count / seconds});
+
+    }
+
+    // Output formats, generation and writing together
+    try {
+
+        for (const char* format : {"bin", "hex", "memb", "elf", "corpus", "text"}) {
+
+            double seconds = best_seconds(repeats, [&]() { generate_and_write(config, count, format, scratch_path); });
+            results.push_back({std::string("format/") + format, count / seconds});
+
+        }
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+
+    }
+
+    std::remove(scratch_path);
+
+    // Thread counts: powers of two up to the core count, and the core count
+    unsigned cores = resolve_threads(0);
+
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, cores)) {
+
+        double seconds = best_seconds(repeats, [&]() { generate_sharded(words.data(), count, config, threads); });
+        results.push_back({"threads/" + std::to_string(threads), count / seconds});
+
+        if (threads == cores) {
+
+            break;
+
+        }
+
+    }
+
+    // Stable, line-oriented JSON
+    std::printf("{\n  \"count\": %zu,\n  \"repeats\": %d,\n  \"results\": [\n", count, repeats);
+
+    for (size_t i = 0; i < results.size(); ++i) {
+
+        std::printf("    {\"name\": \"%s\", \"instr_per_sec\": %.0f, \"ns_per_instr\": %.3f}%s\n", results[i].name.c_str(),
+                    results[i].instr_per_sec, 1e9 / results[i].instr_per_sec, i + 1 < results.size() ? "," : "");
+
+    }
+
+    std::printf("  ]\n}\n");
+
+    if (!baseline_path) {
+
+        return 0;
+
+    }
+
+    // Flag every case that got slower than the baseline by more than the tolerance
+    std::vector<BenchResult> baseline;
+
+    try {
+
+        baseline = load_baseline(baseline_path);
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+
+    }
+
+    int regressions = 0;
+    int unmatched = 0;
+
+    for (const BenchResult& result : results) {
+
+        auto match = std::find_if(baseline.begin(), baseline.end(), [&](const BenchResult& b) { return b.name == result.name; });
+
+        // A case the baseline lacks is listed, not skipped: the baseline is stale
+        if (match == baseline.end() || match->instr_per_sec <= 0) {
+
+            std::fprintf(stderr, "%-20s %12s -> %12.0f instr/s  not in baseline\n", result.name.c_str(), "-", result.instr_per_sec);
+            ++unmatched;
+            continue;
+
+        }
+
+        double change = result.instr_per_sec / match->instr_per_sec - 1.0;
+        bool regressed = change < -tolerance;
+        regressions += regressed;
+
+        std::fprintf(stderr, "%-20s %12.0f -> %12.0f instr/s  %+6.1f%%%s\n", result.name.c_str(), match->instr_per_sec,
+                     result.instr_per_sec, 100.0 * change, regressed ? "  REGRESSION" : "");
+
+    }
+
+    // And so is a baseline case this run no longer has
+    for (const BenchResult& entry : baseline) {
+
+        if (std::none_of(results.begin(), results.end(), [&](const BenchResult& r) { return r.name == entry.name; })) {
+
+            std::fprintf(stderr, "%-20s %12.0f -> %12s instr/s  not in this run\n", entry.name.c_str(), entry.instr_per_sec, "-");
+            ++unmatched;
+
+        }
+
+    }
+
+    std::fprintf(stderr, "%d regression(s) beyond %.0f%%", regressions, 100.0 * tolerance);
+
+    if (unmatched > 0) {
+
+        std::fprintf(stderr, ", %d case(s) without a counterpart; regenerate the baseline", unmatched);
+
+    }
+
+    std::fprintf(stderr, "\n");
+    return regressions == 0 ? 0 : 1;
+
+}
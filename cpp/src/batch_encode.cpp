@@ -0,0 +1,202 @@
+#include <vector>
+
+#include "batch_encode.h"
+#include "batch_encode_impl.h"
+#include "encoders.h"
+#include "rng.h"
+
+//-------------------------------------------------
+// Encoder Tables
+//-------------------------------------------------
+
+static const BatchEncoders batch_encoders_scalar = make_batch_encoders<ScalarVec>(SimdLevel::SCALAR);
+
+#if BATCH_ENCODE_X86
+extern const BatchEncoders batch_encoders_avx2;
+extern const BatchEncoders batch_encoders_avx512;
+#endif
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+const char* simd_level_name(SimdLevel level) {
+
+    switch (level) {
+
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::AVX2:   return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+
+    }
+
+    return "unknown";
+
+}
+
+
+
+SimdLevel detect_simd_level() {
+
+#if BATCH_ENCODE_X86
+    if (__builtin_cpu_supports("avx512f")) {
+
+        return SimdLevel::AVX512;
+
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+
+        return SimdLevel::AVX2;
+
+    }
+#endif
+
+    return SimdLevel::SCALAR;
+
+}
+
+
+
+const BatchEncoders* batch_encoders_for(SimdLevel level) {
+
+    if (level > detect_simd_level()) {
+
+        return nullptr;
+
+    }
+
+    switch (level) {
+
+        case SimdLevel::SCALAR: return &batch_encoders_scalar;
+#if BATCH_ENCODE_X86
+        case SimdLevel::AVX2:   return &batch_encoders_avx2;
+        case SimdLevel::AVX512: return &batch_encoders_avx512;
+#else
+        default:                break;
+#endif
+
+    }
+
+    return nullptr;
+
+}
+
+
+
+const BatchEncoders& batch_encoders() {
+
+    static const BatchEncoders* best = batch_encoders_for(detect_simd_level());
+
+    return *best;
+
+}
+
+
+
+bool verify_batch_encoders(size_t n, uint64_t seed, std::ostream& log) {
+
+    // Random field values, with the leading entries overwritten by immediate
+    // edge cases (every single set bit and the all-zeros/all-ones patterns)
+    // so each scattered immediate bit is exercised in every lane position
+    std::vector<uint32_t> funct7(n), funct3(n), rd(n), rs1(n), rs2(n), imm(n), opcode(n);
+    Xoshiro256ss rng(seed);
+
+    for (size_t i = 0; i < n; ++i) {
+
+        uint64_t word = rng.next();
+        funct7[i] = static_cast<uint32_t>(word);
+        funct3[i] = static_cast<uint32_t>(word >> 7);
+        rd[i] = static_cast<uint32_t>(word >> 10);
+        rs1[i] = static_cast<uint32_t>(word >> 15);
+        rs2[i] = static_cast<uint32_t>(word >> 20);
+        opcode[i] = static_cast<uint32_t>(word >> 25);
+        imm[i] = static_cast<uint32_t>(word >> 32);
+
+        if (i < 32) {
+
+            imm[i] = uint32_t{1} << i;
+
+        } else if (i < 34) {
+
+            imm[i] = (i == 32) ? 0u : ~0u;
+
+        }
+
+    }
+
+    // Reference encodings from the scalar single-instruction encoders
+    std::vector<uint32_t> expected[6];
+    static const char* const names[6] = {"R", "I", "S", "B", "U", "J"};
+
+    for (std::vector<uint32_t>& e : expected) {
+
+        e.resize(n);
+
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+
+        expected[0][i] = encode_R_type(funct7[i], rs2[i], rs1[i], funct3[i], rd[i], opcode[i]);
+        expected[1][i] = encode_I_type(imm[i], rs1[i], funct3[i], rd[i], opcode[i]);
+        expected[2][i] = encode_S_type(imm[i], rs2[i], rs1[i], funct3[i], opcode[i]);
+        expected[3][i] = encode_B_type(imm[i], rs2[i], rs1[i], funct3[i], opcode[i]);
+        expected[4][i] = encode_U_type(imm[i], rd[i], opcode[i]);
+        expected[5][i] = encode_J_type(imm[i], rd[i], opcode[i]);
+
+    }
+
+    bool ok = true;
+    std::vector<uint32_t> actual(n);
+
+    for (SimdLevel level : {SimdLevel::SCALAR, SimdLevel::AVX2, SimdLevel::AVX512}) {
+
+        const BatchEncoders* enc = batch_encoders_for(level);
+
+        if (enc == nullptr) {
+
+            log << "batch encoders [" << simd_level_name(level) << "]: not available, skipped\n";
+            continue;
+
+        }
+
+        bool level_ok = true;
+
+        for (int format = 0; format < 6; ++format) {
+
+            switch (format) {
+
+                case 0: enc->encode_R(actual.data(), n, funct7.data(), rs2.data(), rs1.data(), funct3.data(), rd.data(), opcode.data()); break;
+                case 1: enc->encode_I(actual.data(), n, imm.data(), rs1.data(), funct3.data(), rd.data(), opcode.data()); break;
+                case 2: enc->encode_S(actual.data(), n, imm.data(), rs2.data(), rs1.data(), funct3.data(), opcode.data()); break;
+                case 3: enc->encode_B(actual.data(), n, imm.data(), rs2.data(), rs1.data(), funct3.data(), opcode.data()); break;
+                case 4: enc->encode_U(actual.data(), n, imm.data(), rd.data(), opcode.data()); break;
+                case 5: enc->encode_J(actual.data(), n, imm.data(), rd.data(), opcode.data()); break;
+
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+
+                if (actual[i] != expected[format][i]) {
+
+                    log << "batch encoders [" << simd_level_name(level) << "]: " << names[format]
+                        << "-Type mismatch at " << i << ": got " << std::hex << actual[i]
+                        << ", expected " << expected[format][i] << std::dec << "\n";
+                    level_ok = false;
+                    break;
+
+                }
+
+            }
+
+        }
+
+        log << "batch encoders [" << simd_level_name(level) << "]: " << (level_ok ? "ok" : "FAILED") << "\n";
+        ok = ok && level_ok;
+
+    }
+
+    return ok;
+
+}
@@ -0,0 +1,83 @@
+#ifndef BATCH_ENCODE_H
+#define BATCH_ENCODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+//-------------------------------------------------
+// Structure-of-Arrays Batch Encoders
+//
+// Batch counterparts of encode_R_type ... encode_J_type: element i of out is
+// the scalar encoding of element i of each field array. Vector versions pack
+// 8 (AVX2) or 16 (AVX-512) instructions per step; the best version the CPU
+// supports is selected at runtime, with a portable scalar fallback.
+//-------------------------------------------------
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BATCH_ENCODE_X86 1
+#else
+#define BATCH_ENCODE_X86 0
+#endif
+
+enum class SimdLevel : uint8_t { SCALAR, AVX2, AVX512 };
+
+struct BatchEncoders {
+    SimdLevel level;
+    void (*encode_R)(uint32_t* out, size_t n, const uint32_t* funct7, const uint32_t* rs2, const uint32_t* rs1,
+                     const uint32_t* funct3, const uint32_t* rd, const uint32_t* opcode);
+    void (*encode_I)(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs1, const uint32_t* funct3,
+                     const uint32_t* rd, const uint32_t* opcode);
+    void (*encode_S)(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                     const uint32_t* funct3, const uint32_t* opcode);
+    void (*encode_B)(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                     const uint32_t* funct3, const uint32_t* opcode);
+    void (*encode_U)(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode);
+    void (*encode_J)(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode);
+};
+
+const char* simd_level_name(SimdLevel level);
+
+// Highest level supported by both this build and the running CPU
+SimdLevel detect_simd_level();
+
+// Encoders for a specific level, or nullptr if the build or CPU lacks it
+const BatchEncoders* batch_encoders_for(SimdLevel level);
+
+// Encoders for detect_simd_level(), resolved once
+const BatchEncoders& batch_encoders();
+
+inline void encode_R_batch(uint32_t* out, size_t n, const uint32_t* funct7, const uint32_t* rs2, const uint32_t* rs1,
+                           const uint32_t* funct3, const uint32_t* rd, const uint32_t* opcode) {
+    batch_encoders().encode_R(out, n, funct7, rs2, rs1, funct3, rd, opcode);
+}
+
+inline void encode_I_batch(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs1, const uint32_t* funct3,
+                           const uint32_t* rd, const uint32_t* opcode) {
+    batch_encoders().encode_I(out, n, imm, rs1, funct3, rd, opcode);
+}
+
+inline void encode_S_batch(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                           const uint32_t* funct3, const uint32_t* opcode) {
+    batch_encoders().encode_S(out, n, imm, rs2, rs1, funct3, opcode);
+}
+
+inline void encode_B_batch(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                           const uint32_t* funct3, const uint32_t* opcode) {
+    batch_encoders().encode_B(out, n, imm, rs2, rs1, funct3, opcode);
+}
+
+inline void encode_U_batch(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+    batch_encoders().encode_U(out, n, imm, rd, opcode);
+}
+
+inline void encode_J_batch(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+    batch_encoders().encode_J(out, n, imm, rd, opcode);
+}
+
+// Compare every available level against the scalar encode_*_type functions
+// on n random field sets plus immediate edge cases. Mismatches are reported
+// to log; returns true if all levels agree bit-for-bit.
+bool verify_batch_encoders(size_t n, uint64_t seed, std::ostream& log);
+
+#endif // BATCH_ENCODE_H
@@ -0,0 +1,46 @@
+// AVX2 instantiation of the batch encoders (8 instructions per step).
+// Only reached after detect_simd_level() has confirmed CPU support.
+
+#include "batch_encode.h"
+
+#if BATCH_ENCODE_X86
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "batch_encode_impl.h"
+
+namespace {
+
+struct Avx2Vec {
+
+    using type = __m256i;
+    static constexpr size_t LANES = 8;
+
+    static type load(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(uint32_t* p, type v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static type set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    static type and_(type a, type b) { return _mm256_and_si256(a, b); }
+    static type or_(type a, type b) { return _mm256_or_si256(a, b); }
+    template <int S> static type shl(type v) { return _mm256_slli_epi32(v, S); }
+    template <int S> static type shr(type v) { return _mm256_srli_epi32(v, S); }
+
+};
+
+} // namespace
+
+extern const BatchEncoders batch_encoders_avx2 = make_batch_encoders<Avx2Vec>(SimdLevel::AVX2);
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // BATCH_ENCODE_X86
@@ -0,0 +1,50 @@
+// AVX-512 instantiation of the batch encoders (16 instructions per step).
+// Only reached after detect_simd_level() has confirmed CPU support.
+
+#include "batch_encode.h"
+
+#if BATCH_ENCODE_X86
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+#include "batch_encode_impl.h"
+
+namespace {
+
+struct Avx512Vec {
+
+    using type = __m512i;
+    static constexpr size_t LANES = 16;
+
+    // Zero-masked shifts with every lane enabled; the unmasked intrinsics
+    // trip GCC's -Wmaybe-uninitialized on their undefined passthrough
+    static constexpr __mmask16 ALL_LANES = 0xFFFF;
+
+    static type load(const uint32_t* p) { return _mm512_loadu_si512(p); }
+    static void store(uint32_t* p, type v) { _mm512_storeu_si512(p, v); }
+    static type set1(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    static type and_(type a, type b) { return _mm512_and_si512(a, b); }
+    static type or_(type a, type b) { return _mm512_or_si512(a, b); }
+    template <int S> static type shl(type v) { return _mm512_maskz_slli_epi32(ALL_LANES, v, S); }
+    template <int S> static type shr(type v) { return _mm512_maskz_srli_epi32(ALL_LANES, v, S); }
+
+};
+
+} // namespace
+
+extern const BatchEncoders batch_encoders_avx512 = make_batch_encoders<Avx512Vec>(SimdLevel::AVX512);
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // BATCH_ENCODE_X86
@@ -0,0 +1,204 @@
+#ifndef BATCH_ENCODE_IMPL_H
+#define BATCH_ENCODE_IMPL_H
+
+// Shared body of the batch encoders, instantiated once per vector width by
+// batch_encode.cpp, batch_encode_avx2.cpp and batch_encode_avx512.cpp. Each
+// of those is compiled for a different target, so everything here has
+// internal linkage and never calls the inline encoders in encoders.h;
+// otherwise the linker could keep an AVX-compiled copy for the scalar path.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "batch_encode.h"
+
+namespace {
+
+// One-lane "vector" used for the tail of every batch and the scalar build
+struct ScalarVec {
+
+    using type = uint32_t;
+    static constexpr size_t LANES = 1;
+
+    static type load(const uint32_t* p) { return *p; }
+    static void store(uint32_t* p, type v) { *p = v; }
+    static type set1(uint32_t x) { return x; }
+    static type and_(type a, type b) { return a & b; }
+    static type or_(type a, type b) { return a | b; }
+    template <int S> static type shl(type v) { return v << S; }
+    template <int S> static type shr(type v) { return v >> S; }
+
+};
+
+// ((v >> SHR) & MASK) << SHL
+template <typename V, int SHR, uint32_t MASK, int SHL>
+inline typename V::type field(typename V::type v) {
+
+    return V::template shl<SHL>(V::and_(V::template shr<SHR>(v), V::set1(MASK)));
+
+}
+
+template <typename V>
+inline typename V::type or_all(typename V::type a) {
+
+    return a;
+
+}
+
+template <typename V, typename... Rest>
+inline typename V::type or_all(typename V::type a, Rest... rest) {
+
+    return V::or_(a, or_all<V>(rest...));
+
+}
+
+template <typename V>
+inline typename V::type encode_R_step(const uint32_t* funct7, const uint32_t* rs2, const uint32_t* rs1,
+                                      const uint32_t* funct3, const uint32_t* rd, const uint32_t* opcode) {
+
+    return or_all<V>(field<V, 0, 0x7F, 25>(V::load(funct7)),          // funct7 field (7 bits)
+                     field<V, 0, 0x1F, 20>(V::load(rs2)),             // rs2 field (5 bits)
+                     field<V, 0, 0x1F, 15>(V::load(rs1)),             // rs1 field (5 bits)
+                     field<V, 0, 0x7, 12>(V::load(funct3)),           // funct3 field (3 bits)
+                     field<V, 0, 0x1F, 7>(V::load(rd)),               // rd field (5 bits)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+template <typename V>
+inline typename V::type encode_I_step(const uint32_t* imm, const uint32_t* rs1, const uint32_t* funct3,
+                                      const uint32_t* rd, const uint32_t* opcode) {
+
+    return or_all<V>(field<V, 0, 0xFFF, 20>(V::load(imm)),            // Immediate field (12 bits)
+                     field<V, 0, 0x1F, 15>(V::load(rs1)),             // rs1 field (5 bits)
+                     field<V, 0, 0x7, 12>(V::load(funct3)),           // funct3 field (3 bits)
+                     field<V, 0, 0x1F, 7>(V::load(rd)),               // rd field (5 bits)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+template <typename V>
+inline typename V::type encode_S_step(const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                                      const uint32_t* funct3, const uint32_t* opcode) {
+
+    typename V::type im = V::load(imm);
+
+    return or_all<V>(field<V, 5, 0x7F, 25>(im),                       // imm[11:5] field (7 bits)
+                     field<V, 0, 0x1F, 20>(V::load(rs2)),             // rs2 field (5 bits)
+                     field<V, 0, 0x1F, 15>(V::load(rs1)),             // rs1 field (5 bits)
+                     field<V, 0, 0x7, 12>(V::load(funct3)),           // funct3 field (3 bits)
+                     field<V, 0, 0x1F, 7>(im),                        // imm[4:0] field (5 bits)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+template <typename V>
+inline typename V::type encode_B_step(const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                                      const uint32_t* funct3, const uint32_t* opcode) {
+
+    typename V::type im = V::load(imm);
+
+    return or_all<V>(field<V, 12, 0x1, 31>(im),                       // imm[12] field (1 bit)
+                     field<V, 5, 0x3F, 25>(im),                       // imm[10:5] field (6 bits)
+                     field<V, 0, 0x1F, 20>(V::load(rs2)),             // rs2 field (5 bits)
+                     field<V, 0, 0x1F, 15>(V::load(rs1)),             // rs1 field (5 bits)
+                     field<V, 0, 0x7, 12>(V::load(funct3)),           // funct3 field (3 bits)
+                     field<V, 1, 0xF, 8>(im),                         // imm[4:1] field (4 bits)
+                     field<V, 11, 0x1, 7>(im),                        // imm[11] field (1 bit)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+template <typename V>
+inline typename V::type encode_U_step(const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+
+    return or_all<V>(field<V, 0, 0xFFFFF, 12>(V::load(imm)),          // Immediate field (20 bits)
+                     field<V, 0, 0x1F, 7>(V::load(rd)),               // rd field (5 bits)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+template <typename V>
+inline typename V::type encode_J_step(const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+
+    typename V::type im = V::load(imm);
+
+    return or_all<V>(field<V, 20, 0x1, 31>(im),                       // imm[20] field (1 bit)
+                     field<V, 12, 0xFF, 12>(im),                      // imm[19:12] field (8 bits)
+                     field<V, 11, 0x1, 20>(im),                       // imm[11] field (1 bit)
+                     field<V, 1, 0x3FF, 21>(im),                      // imm[10:1] field (10 bits)
+                     field<V, 0, 0x1F, 7>(V::load(rd)),               // rd field (5 bits)
+                     field<V, 0, 0x7F, 0>(V::load(opcode)));          // opcode field (7 bits)
+
+}
+
+// Full-width steps followed by a scalar tail
+#define BATCH_ENCODE_LOOP(STEP, ...)                                                \
+    size_t i = 0;                                                                   \
+    for (; i + V::LANES <= n; i += V::LANES) {                                      \
+        V::store(out + i, STEP<V>(__VA_ARGS__));                                    \
+    }                                                                               \
+    for (; i < n; ++i) {                                                            \
+        out[i] = STEP<ScalarVec>(__VA_ARGS__);                                      \
+    }
+
+template <typename V>
+void encode_R_impl(uint32_t* out, size_t n, const uint32_t* funct7, const uint32_t* rs2, const uint32_t* rs1,
+                   const uint32_t* funct3, const uint32_t* rd, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_R_step, funct7 + i, rs2 + i, rs1 + i, funct3 + i, rd + i, opcode + i)
+
+}
+
+template <typename V>
+void encode_I_impl(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs1, const uint32_t* funct3,
+                   const uint32_t* rd, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_I_step, imm + i, rs1 + i, funct3 + i, rd + i, opcode + i)
+
+}
+
+template <typename V>
+void encode_S_impl(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                   const uint32_t* funct3, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_S_step, imm + i, rs2 + i, rs1 + i, funct3 + i, opcode + i)
+
+}
+
+template <typename V>
+void encode_B_impl(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rs2, const uint32_t* rs1,
+                   const uint32_t* funct3, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_B_step, imm + i, rs2 + i, rs1 + i, funct3 + i, opcode + i)
+
+}
+
+template <typename V>
+void encode_U_impl(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_U_step, imm + i, rd + i, opcode + i)
+
+}
+
+template <typename V>
+void encode_J_impl(uint32_t* out, size_t n, const uint32_t* imm, const uint32_t* rd, const uint32_t* opcode) {
+
+    BATCH_ENCODE_LOOP(encode_J_step, imm + i, rd + i, opcode + i)
+
+}
+
+#undef BATCH_ENCODE_LOOP
+
+template <typename V>
+constexpr BatchEncoders make_batch_encoders(SimdLevel level) {
+
+    return {level,
+            encode_R_impl<V>, encode_I_impl<V>, encode_S_impl<V>,
+            encode_B_impl<V>, encode_U_impl<V>, encode_J_impl<V>};
+
+}
+
+} // namespace
+
+#endif // BATCH_ENCODE_IMPL_H
@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "checkpoint.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+// File magic for checkpoints
+static const char CHECKPOINT_MAGIC[8] = {'R', 'V', '3', '2', 'C', 'K', 'P', '2'};
+
+static void put(std::ostream& out, uint64_t value, int bytes) {
+
+    unsigned char buf[8];
+
+    for (int b = 0; b < bytes; ++b) {
+
+        buf[b] = static_cast<unsigned char>(value >> (8 * b));
+
+    }
+
+    out.write(reinterpret_cast<const char*>(buf), bytes);
+
+}
+
+static uint64_t get(std::istream& in, int bytes) {
+
+    unsigned char buf[8] = {};
+    in.read(reinterpret_cast<char*>(buf), bytes);
+
+    uint64_t value = 0;
+
+    for (int b = 0; b < bytes; ++b) {
+
+        value |= static_cast<uint64_t>(buf[b]) << (8 * b);
+
+    }
+
+    return value;
+
+}
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+void write_config(std::ostream& out, const GenConfig& config) {
+
+    put(out, config.seed, 8);
+    put(out, static_cast<uint64_t>(config.rng), 1);
+    put(out, config.instr_mask, 8);
+
+    for (double w : config.weights) {
+
+        uint64_t bits;
+        std::memcpy(&bits, &w, sizeof(bits));
+        put(out, bits, 8);
+
+    }
+
+    put(out, config.regs.no_x0_rd, 1);
+    put(out, config.regs.base_regs, 4);
+    put(out, config.regs.rd_ne_rs1, 1);
+    put(out, config.regs.hot_regs, 4);
+    put(out, config.regs.hot_percent, 4);
+
+    for (uint32_t percent : config.hazards.raw_percent) {
+
+        put(out, percent, 4);
+
+    }
+
+    put(out, config.hazards.load_use_percent, 4);
+    put(out, config.hazards.waw_percent, 4);
+
+}
+
+
+
+bool read_config(std::istream& in, GenConfig& config) {
+
+    config.seed = get(in, 8);
+    uint64_t rng = get(in, 1);
+    config.instr_mask = get(in, 8) & ALL_INSTRS;
+
+    for (double& w : config.weights) {
+
+        uint64_t bits = get(in, 8);
+        std::memcpy(&w, &bits, sizeof(w));
+
+    }
+
+    config.regs.no_x0_rd = get(in, 1) != 0;
+    config.regs.base_regs = static_cast<uint32_t>(get(in, 4));
+    config.regs.rd_ne_rs1 = get(in, 1) != 0;
+    config.regs.hot_regs = static_cast<uint32_t>(get(in, 4));
+    config.regs.hot_percent = static_cast<uint32_t>(get(in, 4));
+
+    for (uint32_t& percent : config.hazards.raw_percent) {
+
+        percent = static_cast<uint32_t>(get(in, 4));
+
+    }
+
+    config.hazards.load_use_percent = static_cast<uint32_t>(get(in, 4));
+    config.hazards.waw_percent = static_cast<uint32_t>(get(in, 4));
+
+    if (!in || rng > static_cast<uint64_t>(RngKind::PHILOX)) {
+
+        return false;
+
+    }
+
+    config.rng = static_cast<RngKind>(rng);
+    return true;
+
+}
+
+
+
+void save_checkpoint(const char* path, const Checkpoint& checkpoint) {
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": cannot open for writing");
+
+    }
+
+    file.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    put(file, INSTR_COUNT, 4);
+    write_config(file, checkpoint.config);
+    put(file, checkpoint.position, 8);
+    put(file, checkpoint.has_coverage, 1);
+
+    if (checkpoint.has_coverage) {
+
+        checkpoint.coverage.save(file, path);
+
+    }
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": write failed");
+
+    }
+
+}
+
+
+
+Checkpoint load_checkpoint(const char* path) {
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": cannot open");
+
+    }
+
+    char magic[sizeof(CHECKPOINT_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+
+    if (!file || !std::equal(magic, magic + sizeof(magic), CHECKPOINT_MAGIC) || get(file, 4) != INSTR_COUNT) {
+
+        throw std::runtime_error(std::string(path) + ": not a checkpoint of this build");
+
+    }
+
+    Checkpoint checkpoint;
+    bool valid = read_config(file, checkpoint.config);
+    checkpoint.position = get(file, 8);
+    checkpoint.has_coverage = get(file, 1) != 0;
+
+    if (!valid || !file) {
+
+        throw std::runtime_error(std::string(path) + ": truncated or corrupt checkpoint");
+
+    }
+
+    if (checkpoint.has_coverage) {
+
+        checkpoint.coverage.load(file, path);
+
+    }
+
+    return checkpoint;
+
+}
@@ -0,0 +1,46 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include "coverage.h"
+#include "generator.h"
+
+//-------------------------------------------------
+// Generator Checkpoints
+//
+// Shard k of a stream depends only on (config, k), so the complete
+// generator state is the config plus the index of the next instruction.
+// A checkpoint stores both, along with the coverage collected so far. That
+// is enough to resume a run, or to regenerate any window of it with
+// stream_rng_at() without replaying the instructions before it.
+//
+// Binary file, little-endian: 8-byte magic, instruction count, seed, rng,
+// instruction mask, weights (IEEE-754 bit patterns), register constraints,
+// hazard percentages, position, coverage flag and, if set, the coverage map.
+//-------------------------------------------------
+
+struct Checkpoint {
+
+    GenConfig config;
+
+    // Index of the next instruction of the stream
+    uint64_t position = 0;
+
+    bool has_coverage = false;
+    CoverageMap coverage;
+
+};
+
+// Both throw std::runtime_error
+void save_checkpoint(const char* path, const Checkpoint& checkpoint);
+Checkpoint load_checkpoint(const char* path);
+
+// The stream options of a config in the layout above, shared with corpus
+// headers; read_config() returns false on a truncated or invalid record
+void write_config(std::ostream& out, const GenConfig& config);
+bool read_config(std::istream& in, GenConfig& config);
+
+#endif // CHECKPOINT_H
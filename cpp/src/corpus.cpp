@@ -0,0 +1,914 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "corpus.h"
+#include "checkpoint.h"
+#include "decoder.h"
+#include "encoders.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+constexpr char CORPUS_MAGIC[8] = {'R', 'V', '3', '2', 'C', 'R', 'P', '1'};
+constexpr size_t HEADER_SIZE = 28;
+constexpr size_t TRAILER_SIZE = 24;
+constexpr uint32_t MAX_BLOCK_SIZE = uint32_t{1} << 20;
+
+enum Column { COL_ID, COL_RD, COL_RS1, COL_RS2, COL_IMM, COLUMNS };
+enum Encoding : uint8_t { PACKED, DELTA_VARINT };
+
+// Bits of each column's field for every instruction (0 where the format
+// does not encode it), and how immediates map to their raw field
+struct ColumnTable {
+
+    uint8_t bits[COLUMNS][INSTR_COUNT];
+    bool halved[INSTR_COUNT];
+    bool sign[INSTR_COUNT];
+
+    constexpr ColumnTable() : bits(), halved(), sign() {
+
+        for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+            const InstrDesc& desc = instr_table[i];
+            bool shift = desc.instr_class == InstrClass::SHIFT;
+            Format f = desc.format;
+
+            bits[COL_ID][i] = 6;
+            bits[COL_RD][i] = f == Format::R || f == Format::I || f == Format::U || f == Format::J ? 5 : 0;
+            bits[COL_RS1][i] = f == Format::R || f == Format::I || f == Format::S || f == Format::B ? 5 : 0;
+            bits[COL_RS2][i] = f == Format::R || f == Format::S || f == Format::B ? 5 : 0;
+            bits[COL_IMM][i] = f == Format::R ? 0 : shift ? 5 : f == Format::U || f == Format::J ? 20 : 12;
+            halved[i] = f == Format::B || f == Format::J;
+            sign[i] = f != Format::R && f != Format::U && !shift;
+
+        }
+
+    }
+
+};
+
+constexpr ColumnTable column_table{};
+
+static_assert(INSTR_COUNT <= 64, "ids must fit the 6-bit id column");
+
+uint32_t field_value(int col, const InstrRecord& rec) {
+
+    switch (col) {
+
+        case COL_ID:  return rec.id;
+        case COL_RD:  return rec.rd;
+        case COL_RS1: return rec.rs1;
+        case COL_RS2: return rec.rs2;
+
+    }
+
+    uint32_t bits = column_table.bits[COL_IMM][rec.id];
+    return (static_cast<uint32_t>(rec.imm) >> column_table.halved[rec.id]) & ((uint32_t{1} << bits) - 1);
+
+}
+
+void set_field(int col, InstrRecord& rec, uint32_t value) {
+
+    switch (col) {
+
+        case COL_ID:  rec = {static_cast<uint8_t>(value), 0, 0, 0, 0}; return;
+        case COL_RD:  rec.rd = static_cast<uint8_t>(value); return;
+        case COL_RS1: rec.rs1 = static_cast<uint8_t>(value); return;
+        case COL_RS2: rec.rs2 = static_cast<uint8_t>(value); return;
+
+    }
+
+    if (column_table.sign[rec.id]) {
+
+        uint32_t field = static_cast<uint32_t>(sign_extend(value, column_table.bits[COL_IMM][rec.id]));
+        rec.imm = static_cast<int32_t>(field << column_table.halved[rec.id]);
+
+    } else {
+
+        rec.imm = static_cast<int32_t>(value);
+
+    }
+
+}
+
+void put_le(unsigned char* p, uint64_t value, int bytes) {
+
+    for (int i = 0; i < bytes; ++i) {
+
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+
+    }
+
+}
+
+uint64_t get_le(const unsigned char* p, int bytes) {
+
+    uint64_t value = 0;
+
+    for (int i = 0; i < bytes; ++i) {
+
+        value |= uint64_t{p[i]} << (8 * i);
+
+    }
+
+    return value;
+
+}
+
+uint32_t bit_length(uint32_t value) {
+
+    uint32_t bits = 0;
+
+    for (; value; value >>= 1) {
+
+        ++bits;
+
+    }
+
+    return bits;
+
+}
+
+// LSB-first bit stream; entries are at most 32 bits
+class BitWriter {
+
+public:
+
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void put(uint32_t value, uint32_t width) {
+
+        buffer |= uint64_t{value} << pending;
+        pending += width;
+
+        for (; pending >= 8; pending -= 8) {
+
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer >>= 8;
+
+        }
+
+    }
+
+    void flush() {
+
+        if (pending > 0) {
+
+            out.push_back(static_cast<unsigned char>(buffer));
+
+        }
+
+    }
+
+private:
+
+    std::vector<unsigned char>& out;
+    uint64_t buffer = 0;
+    uint32_t pending = 0;
+
+};
+
+class BitReader {
+
+public:
+
+    BitReader(const unsigned char* p, const unsigned char* end) : p(p), end(end) {}
+
+    // False if the stream ends first
+    bool get(uint32_t width, uint64_t& value) {
+
+        for (; available < width; available += 8) {
+
+            if (p == end) {
+
+                return false;
+
+            }
+
+            buffer |= uint64_t{*p++} << available;
+
+        }
+
+        value = buffer & ((uint64_t{1} << width) - 1);
+        buffer >>= width;
+        available -= width;
+        return true;
+
+    }
+
+    // Every byte read, with less than a byte of padding left
+    bool done() const { return p == end; }
+
+private:
+
+    const unsigned char* p;
+    const unsigned char* end;
+    uint64_t buffer = 0;
+    uint32_t available = 0;
+
+};
+
+// Fill column col of out[0..n) from next(bits, value), which yields the
+// entry of each record whose format has the field. False on bad data.
+template <typename Next>
+bool decode_column(int col, InstrRecord* out, size_t n, Next next) {
+
+    for (size_t i = 0; i < n; ++i) {
+
+        uint32_t bits = column_table.bits[col][col == COL_ID ? 0 : out[i].id];
+        uint64_t value;
+
+        if (bits == 0) {
+
+            continue;
+
+        }
+
+        if (!next(bits, value) || (value >> bits) != 0 || (col == COL_ID && value >= INSTR_COUNT)) {
+
+            return false;
+
+        }
+
+        set_field(col, out[i], static_cast<uint32_t>(value));
+
+    }
+
+    return true;
+
+}
+
+std::system_error io_error(const std::string& what) {
+
+    return std::system_error(errno, std::generic_category(), what);
+
+}
+
+} // namespace
+
+
+//-------------------------------------------------
+// Corpus Writer
+//-------------------------------------------------
+
+CorpusWriter::CorpusWriter(const char* path, const GenConfig* config, uint64_t start) : file(path) {
+
+    std::string config_bytes;
+
+    if (config) {
+
+        std::ostringstream out;
+        write_config(out, *config);
+        config_bytes = out.str();
+
+    }
+
+    unsigned char header[HEADER_SIZE];
+    std::memcpy(header, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+    put_le(header + 8, INSTR_COUNT, 4);
+    put_le(header + 12, CORPUS_BLOCK_SIZE, 4);
+    put_le(header + 16, start, 8);
+    put_le(header + 24, config_bytes.size(), 4);
+
+    file.append(header, sizeof(header));
+    file.append(config_bytes.data(), config_bytes.size());
+    records.reserve(CORPUS_BLOCK_SIZE);
+
+}
+
+
+
+void CorpusWriter::write(const uint32_t* words, size_t n) {
+
+    for (size_t i = 0; i < n; ++i) {
+
+        InstrRecord rec;
+
+        if (!decode_instr(words[i], rec)) {
+
+            char text[64];
+            std::snprintf(text, sizeof(text), "corpus output: 0x%08x is not an RV32I instruction", words[i]);
+            throw std::invalid_argument(text);
+
+        }
+
+        records.push_back(rec);
+
+        if (records.size() == CORPUS_BLOCK_SIZE) {
+
+            write_block();
+
+        }
+
+    }
+
+}
+
+
+
+void CorpusWriter::write_block() {
+
+    offsets.push_back(file.bytes_written());
+
+    unsigned char count[4];
+    put_le(count, records.size(), 4);
+    file.append(count, sizeof(count));
+
+    for (int col = 0; col < COLUMNS; ++col) {
+
+        // Packed width: enough for the widest entry of the block
+        uint32_t all = 0;
+
+        for (const InstrRecord& rec : records) {
+
+            all |= column_table.bits[col][rec.id] ? field_value(col, rec) : 0;
+
+        }
+
+        uint32_t width = bit_length(all);
+        uint32_t prev = 0;
+        BitWriter bits(packed);
+        packed.clear();
+        varint.clear();
+
+        for (const InstrRecord& rec : records) {
+
+            uint32_t field_bits = column_table.bits[col][rec.id];
+
+            if (field_bits == 0) {
+
+                continue;
+
+            }
+
+            uint32_t value = field_value(col, rec);
+            bits.put(value, std::min(width, field_bits));
+
+            int64_t delta = static_cast<int64_t>(value) - static_cast<int64_t>(prev);
+            uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+
+            for (; zigzag >= 0x80; zigzag >>= 7) {
+
+                varint.push_back(static_cast<unsigned char>(zigzag | 0x80));
+
+            }
+
+            varint.push_back(static_cast<unsigned char>(zigzag));
+            prev = value;
+
+        }
+
+        bits.flush();
+
+        bool use_varint = varint.size() < packed.size();
+        const std::vector<unsigned char>& data = use_varint ? varint : packed;
+        unsigned char header[6];
+        header[0] = use_varint ? DELTA_VARINT : PACKED;
+        header[1] = static_cast<unsigned char>(width);
+        put_le(header + 2, data.size(), 4);
+
+        file.append(header, sizeof(header));
+        file.append(data.data(), data.size());
+
+    }
+
+    total += records.size();
+    records.clear();
+
+}
+
+
+
+void CorpusWriter::finish() {
+
+    if (!records.empty()) {
+
+        write_block();
+
+    }
+
+    uint64_t index_offset = file.bytes_written();
+    offsets.push_back(index_offset);
+
+    for (uint64_t offset : offsets) {
+
+        unsigned char bytes[8];
+        put_le(bytes, offset, 8);
+        file.append(bytes, sizeof(bytes));
+
+    }
+
+    unsigned char trailer[TRAILER_SIZE];
+    put_le(trailer, total, 8);
+    put_le(trailer + 8, index_offset, 8);
+    std::memcpy(trailer + 16, CORPUS_MAGIC, sizeof(CORPUS_MAGIC));
+
+    file.append(trailer, sizeof(trailer));
+    file.flush();
+
+}
+
+
+//-------------------------------------------------
+// Corpus Reader
+//-------------------------------------------------
+
+Corpus::Corpus(const char* path) : file_path(path) {
+
+    int fd = ::open(path, O_RDONLY);
+
+    if (fd < 0) {
+
+        throw io_error(std::string("cannot open ") + path);
+
+    }
+
+    struct stat st;
+
+    if (::fstat(fd, &st) != 0) {
+
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        throw io_error(std::string("cannot stat ") + path);
+
+    }
+
+    length = static_cast<size_t>(st.st_size);
+
+    if (length < HEADER_SIZE + TRAILER_SIZE + 8) {
+
+        ::close(fd);
+        corrupt("file too short");
+
+    }
+
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+
+        errno = err;
+        throw io_error(std::string("cannot map ") + path);
+
+    }
+
+    base = static_cast<const unsigned char*>(mapping);
+
+    try {
+
+        if (std::memcmp(base, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0 || get_le(base + 8, 4) != INSTR_COUNT) {
+
+            throw std::runtime_error(file_path + ": not a corpus of this build");
+
+        }
+
+        block_records = static_cast<uint32_t>(get_le(base + 12, 4));
+        first_index = get_le(base + 16, 8);
+        uint64_t config_bytes = get_le(base + 24, 4);
+        uint64_t header_end = HEADER_SIZE + config_bytes;
+
+        if (block_records == 0 || block_records > MAX_BLOCK_SIZE) {
+
+            corrupt("bad block size");
+
+        }
+
+        if (header_end > length - TRAILER_SIZE) {
+
+            corrupt("header runs past the index");
+
+        }
+
+        if (config_bytes > 0) {
+
+            std::istringstream in(std::string(reinterpret_cast<const char*>(base) + HEADER_SIZE, config_bytes));
+
+            if (!read_config(in, stream_config) || in.peek() != std::char_traits<char>::eof()) {
+
+                corrupt("bad config");
+
+            }
+
+            config_recorded = true;
+
+        }
+
+        // The trailer locates the index, which must fill the rest of the file
+        const unsigned char* trailer = base + length - TRAILER_SIZE;
+        count = get_le(trailer, 8);
+        uint64_t index_offset = get_le(trailer + 8, 8);
+        uint64_t blocks = count / block_records + (count % block_records != 0);
+
+        if (std::memcmp(trailer + 16, CORPUS_MAGIC, sizeof(CORPUS_MAGIC)) != 0 || index_offset < header_end ||
+            index_offset > length - TRAILER_SIZE) {
+
+            corrupt("bad trailer");
+
+        }
+
+        uint64_t index_bytes = length - TRAILER_SIZE - index_offset;
+
+        if (index_bytes % 8 != 0 || index_bytes < 8 || index_bytes / 8 - 1 != blocks) {
+
+            corrupt("index does not match the record count");
+
+        }
+
+        offsets.resize(static_cast<size_t>(blocks + 1));
+
+        for (size_t b = 0; b < offsets.size(); ++b) {
+
+            offsets[b] = get_le(base + index_offset + 8 * b, 8);
+
+            if (offsets[b] < (b ? offsets[b - 1] : header_end)) {
+
+                corrupt("index out of order");
+
+            }
+
+        }
+
+        if (offsets.front() != header_end || offsets.back() != index_offset) {
+
+            corrupt("index does not cover the blocks");
+
+        }
+
+    } catch (...) {
+
+        ::munmap(const_cast<unsigned char*>(base), length);
+        throw;
+
+    }
+
+}
+
+
+
+Corpus::~Corpus() {
+
+    ::munmap(const_cast<unsigned char*>(base), length);
+
+}
+
+
+
+void Corpus::corrupt(const std::string& what) const {
+
+    throw std::runtime_error(file_path + ": corrupt corpus (" + what + ")");
+
+}
+
+
+
+size_t Corpus::decode_block(uint64_t b, InstrRecord* out) const {
+
+    if (b >= block_count()) {
+
+        throw std::out_of_range("corpus block out of range");
+
+    }
+
+    const unsigned char* p = base + offsets[b];
+    const unsigned char* end = base + offsets[b + 1];
+    uint64_t expected = b + 1 < block_count() ? block_records : count - b * block_records;
+    std::string where = "block " + std::to_string(b);
+
+    if (end - p < 4 || get_le(p, 4) != expected) {
+
+        corrupt(where + ": bad record count");
+
+    }
+
+    size_t n = static_cast<size_t>(expected);
+    p += 4;
+
+    for (int col = 0; col < COLUMNS; ++col) {
+
+        if (end - p < 6) {
+
+            corrupt(where + ": truncated column");
+
+        }
+
+        uint8_t encoding = p[0];
+        uint32_t width = p[1];
+        uint64_t bytes = get_le(p + 2, 4);
+        p += 6;
+
+        if (bytes > static_cast<uint64_t>(end - p)) {
+
+            corrupt(where + ": column runs past the block");
+
+        }
+
+        const unsigned char* data_end = p + bytes;
+        bool ok = false;
+
+        if (encoding == PACKED && width <= 32) {
+
+            BitReader reader(p, data_end);
+            ok = decode_column(col, out, n, [&](uint32_t bits, uint64_t& value) { return reader.get(std::min(width, bits), value); });
+            ok = ok && reader.done();
+
+        } else if (encoding == DELTA_VARINT) {
+
+            const unsigned char* q = p;
+            uint64_t prev = 0;
+
+            ok = decode_column(col, out, n, [&](uint32_t, uint64_t& value) {
+
+                uint64_t zigzag = 0;
+
+                for (int shift = 0; ; shift += 7) {
+
+                    if (q == data_end || shift > 63) {
+
+                        return false;
+
+                    }
+
+                    zigzag |= uint64_t{*q & 0x7Fu} << shift;
+
+                    if ((*q++ & 0x80) == 0) {
+
+                        break;
+
+                    }
+
+                }
+
+                value = prev + ((zigzag >> 1) ^ (0 - (zigzag & 1)));
+                prev = value;
+                return true;
+
+            });
+
+            ok = ok && q == data_end;
+
+        }
+
+        if (!ok) {
+
+            corrupt(where + ": bad column " + std::to_string(col));
+
+        }
+
+        p = data_end;
+
+    }
+
+    if (p != end) {
+
+        corrupt(where + ": trailing bytes");
+
+    }
+
+    return n;
+
+}
+
+
+
+InstrRecord Corpus::at(uint64_t k) const {
+
+    if (k >= count) {
+
+        throw std::out_of_range("corpus index out of range");
+
+    }
+
+    std::vector<InstrRecord> block(block_records);
+    decode_block(k / block_records, block.data());
+    return block[k % block_records];
+
+}
+
+
+
+void Corpus::decode(uint64_t first, size_t n, InstrRecord* out, unsigned threads) const {
+
+    if (first > count || n > count - first) {
+
+        throw std::out_of_range("corpus range out of range");
+
+    }
+
+    if (n == 0) {
+
+        return;
+
+    }
+
+    uint64_t first_block = first / block_records;
+    uint64_t blocks = (first + n - 1) / block_records - first_block + 1;
+    threads = static_cast<unsigned>(std::min<uint64_t>(resolve_threads(threads), blocks));
+
+    std::atomic<uint64_t> next_block{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+
+        try {
+
+            std::vector<InstrRecord> scratch(block_records);
+
+            for (uint64_t k = next_block.fetch_add(1, std::memory_order_relaxed); k < blocks && !failed.load(std::memory_order_relaxed);
+                 k = next_block.fetch_add(1, std::memory_order_relaxed)) {
+
+                // Blocks inside the range decode in place; the two ends
+                // through scratch
+                uint64_t b = first_block + k;
+                uint64_t begin = b * block_records;
+                uint64_t end = std::min(begin + block_records, count);
+                uint64_t lo = std::max(begin, first);
+                uint64_t hi = std::min(end, first + n);
+
+                if (lo == begin && hi == end) {
+
+                    decode_block(b, out + (begin - first));
+
+                } else {
+
+                    decode_block(b, scratch.data());
+                    std::copy(scratch.begin() + (lo - begin), scratch.begin() + (hi - begin), out + (lo - first));
+
+                }
+
+            }
+
+        } catch (...) {
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+
+            if (!error) {
+
+                error = std::current_exception();
+
+            }
+
+            failed.store(true, std::memory_order_relaxed);
+
+        }
+
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        pool.emplace_back(worker);
+
+    }
+
+    worker();
+
+    for (std::thread& t : pool) {
+
+        t.join();
+
+    }
+
+    if (error) {
+
+        std::rethrow_exception(error);
+
+    }
+
+}
+
+
+//-------------------------------------------------
+// Verification
+//-------------------------------------------------
+
+bool verify_corpus(const GenConfig& config, std::ostream& log) {
+
+    // A fresh file under $TMPDIR (or /tmp)
+    const char* tmp = std::getenv("TMPDIR");
+    std::string path = std::string(tmp && *tmp ? tmp : "/tmp") + "/gen_rand_corpus_XXXXXX";
+    int fd = ::mkstemp(&path[0]);
+
+    if (fd < 0) {
+
+        log << "  corpus: cannot create a file in " << (tmp && *tmp ? tmp : "/tmp") << ": " << std::strerror(errno) << "\n";
+        return false;
+
+    }
+
+    ::close(fd);
+    const uint64_t start = 12345;
+    const size_t n = 100003;
+    uint64_t mismatches = 0;
+    uint64_t bytes = 0;
+
+    std::vector<uint32_t> words(n);
+    ShardedStream stream(config);
+    stream.seek(start);
+    stream.generate(words.data(), n);
+
+    // The stream as generated (packed columns), then sorted so that the
+    // fields change slowly (delta columns)
+    std::vector<uint32_t> sorted = words;
+    std::sort(sorted.begin(), sorted.end());
+
+    try {
+
+        for (const std::vector<uint32_t>* expected : {&words, &sorted}) {
+
+            CorpusWriter writer(path.c_str(), &config, start);
+            writer.write(expected->data(), n);
+            writer.finish();
+
+            Corpus corpus(path.c_str());
+            std::vector<InstrRecord> serial(n);
+            std::vector<InstrRecord> parallel(n - 1000);
+            corpus.decode(0, n, serial.data());
+            corpus.decode(777, parallel.size(), parallel.data(), 4);
+
+            mismatches += corpus.size() != n || corpus.start() != start || !corpus.has_config() || corpus.config().seed != config.seed;
+
+            for (size_t i = 0; i < n; ++i) {
+
+                mismatches += encode_record(serial[i]) != (*expected)[i];
+
+            }
+
+            for (size_t i = 0; i < parallel.size(); ++i) {
+
+                mismatches += encode_record(parallel[i]) != (*expected)[777 + i];
+
+            }
+
+            for (uint64_t k = 1; k < n; k = k * 3 + 1) {
+
+                mismatches += encode_record(corpus.at(k)) != (*expected)[k];
+
+            }
+
+            if (expected == &words) {
+
+                struct stat st;
+                bytes = ::stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+
+            }
+
+        }
+
+        // A truncated file must be rejected, not misread
+        struct stat st;
+
+        if (::stat(path.c_str(), &st) != 0 || ::truncate(path.c_str(), st.st_size - 1) != 0) {
+
+            throw io_error("cannot truncate " + path);
+
+        }
+
+        try {
+
+            Corpus truncated(path.c_str());
+            ++mismatches;
+            log << "  corpus: truncated file accepted\n";
+
+        } catch (const std::runtime_error&) {
+
+        }
+
+    } catch (const std::exception& e) {
+
+        log << "  corpus: " << e.what() << "\n";
+        ++mismatches;
+
+    }
+
+    std::remove(path.c_str());
+
+    log << "corpus: " << n << " instructions, " << bytes << " bytes (" << static_cast<double>(bytes) / n
+        << " per instruction), " << mismatches << " mismatches\n";
+    return mismatches == 0;
+
+}
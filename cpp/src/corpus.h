@@ -0,0 +1,124 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "generator.h"
+#include "output.h"
+
+//-------------------------------------------------
+// Columnar Stimulus Corpus
+//
+// Compact storage for generated streams: records are cut into blocks of
+// CORPUS_BLOCK_SIZE and each block stores them column by column (id, rd,
+// rs1, rs2, imm). A register or immediate column only holds entries for
+// the formats that encode that field, and the immediate column holds the
+// raw instruction field (5, 12 or 20 bits). Every column of every block
+// is written in whichever of two encodings is smaller:
+//   PACKED        each entry in min(width, field bits) bits, LSB first
+//   DELTA_VARINT  zigzag delta to the previous entry as LEB128
+// Random fields pack best; sorted or slowly changing ones, such as a
+// --unique walk of one instruction's fields, shrink with deltas.
+//
+// File layout, little-endian:
+//   header   8-byte magic, instruction table size, block size, stream
+//            index of the first record, config length and, if non-zero,
+//            the config as checkpoints store it
+//   blocks   u32 records, then per column u8 encoding, u8 width,
+//            u32 bytes and the data
+//   index    u64 offset of every block, then of the index itself
+//   trailer  u64 records, u64 index offset, 8-byte magic
+// The index is written last, so corpora can be streamed to a pipe.
+//-------------------------------------------------
+
+constexpr uint32_t CORPUS_BLOCK_SIZE = 4096;
+
+// OutputWriter that decodes each word into its record; throws
+// std::invalid_argument on a word that is not an RV32I instruction.
+// config, when given, is recorded in the header with start.
+class CorpusWriter : public OutputWriter {
+
+public:
+
+    // path == nullptr or "-" writes to stdout
+    CorpusWriter(const char* path, const GenConfig* config, uint64_t start);
+
+    void write(const uint32_t* words, size_t n) override;
+    void finish() override;
+
+private:
+
+    void write_block();
+
+    BlockFile file;
+    std::vector<InstrRecord> records;
+    std::vector<uint64_t> offsets;
+    std::vector<unsigned char> packed;
+    std::vector<unsigned char> varint;
+    uint64_t total = 0;
+
+};
+
+// Read-only view of a corpus file, mapped into memory. The constructor
+// checks the header, trailer and index; blocks are checked as they are
+// decoded. Throws std::system_error on I/O failure and std::runtime_error
+// on a file that is not a valid corpus.
+class Corpus {
+
+public:
+
+    explicit Corpus(const char* path);
+    ~Corpus();
+
+    Corpus(const Corpus&) = delete;
+    Corpus& operator=(const Corpus&) = delete;
+
+    // Instructions stored, and the stream index of the first of them
+    uint64_t size() const { return count; }
+    uint64_t start() const { return first_index; }
+
+    // Stream options of the run that wrote the corpus, if recorded
+    bool has_config() const { return config_recorded; }
+    const GenConfig& config() const { return stream_config; }
+
+    // Records per block (the last may hold fewer)
+    uint32_t block_size() const { return block_records; }
+    uint64_t block_count() const { return offsets.size() - 1; }
+
+    // Decode block b into out (room for block_size() records) and return
+    // its record count
+    size_t decode_block(uint64_t b, InstrRecord* out) const;
+
+    // Record k of the corpus, decoding only its block
+    InstrRecord at(uint64_t k) const;
+
+    // Records [first, first + n) of the corpus, using up to `threads`
+    // workers, one block at a time each
+    void decode(uint64_t first, size_t n, InstrRecord* out, unsigned threads = 1) const;
+
+private:
+
+    [[noreturn]] void corrupt(const std::string& what) const;
+
+    std::string file_path;
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+    uint64_t count = 0;
+    uint64_t first_index = 0;
+    uint32_t block_records = 0;
+    bool config_recorded = false;
+    GenConfig stream_config;
+    std::vector<uint64_t> offsets;
+
+};
+
+// Write a stream as a corpus to a temporary file and compare its records,
+// read back serially, in parallel and at random indices, with the stream.
+// Failures are reported to log; returns true if everything matches.
+bool verify_corpus(const GenConfig& config, std::ostream& log);
+
+#endif // CORPUS_H
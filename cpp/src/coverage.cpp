@@ -0,0 +1,625 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "coverage.h"
+#include "decoder.h"
+#include "shard.h"
+
+using namespace coverage_detail;
+
+//-------------------------------------------------
+// Coverage Map
+//-------------------------------------------------
+
+// File magic for saved maps
+static const char COVERAGE_MAGIC[8] = {'R', 'V', '3', '2', 'C', 'O', 'V', '1'};
+
+static size_t group_offset(CoverageGroup group) {
+
+    switch (group) {
+
+        case CoverageGroup::CROSS:       return CROSS_OFFSET;
+        case CoverageGroup::IMM_CORNER:  return CORNER_OFFSET;
+        case CoverageGroup::SHAMT:       return SHAMT_OFFSET;
+        case CoverageGroup::BRANCH_SIGN: return SIGN_OFFSET;
+
+    }
+
+    return 0;
+
+}
+
+static size_t group_bits(CoverageGroup group) {
+
+    switch (group) {
+
+        case CoverageGroup::CROSS:       return CROSS_BITS;
+        case CoverageGroup::IMM_CORNER:  return CORNER_BITS;
+        case CoverageGroup::SHAMT:       return SHAMT_BITS;
+        case CoverageGroup::BRANCH_SIGN: return SIGN_BITS;
+
+    }
+
+    return 0;
+
+}
+
+
+
+const char* coverage_group_name(CoverageGroup group) {
+
+    switch (group) {
+
+        case CoverageGroup::CROSS:       return "cross";
+        case CoverageGroup::IMM_CORNER:  return "imm corners";
+        case CoverageGroup::SHAMT:       return "shamt";
+        case CoverageGroup::BRANCH_SIGN: return "branch sign";
+
+    }
+
+    return "unknown";
+
+}
+
+
+
+void CoverageMap::sample_word(uint32_t word) {
+
+    InstrRecord rec;
+
+    if (decode_instr(word, rec)) {
+
+        sample(rec);
+
+    }
+
+}
+
+
+
+void CoverageMap::merge(const CoverageMap& other) {
+
+    for (size_t i = 0; i < words.size(); ++i) {
+
+        words[i] |= other.words[i];
+
+    }
+
+}
+
+
+
+size_t CoverageMap::count(CoverageGroup group, const CoverageMap* mask) const {
+
+    size_t first = group_offset(group) / 64;
+    size_t last = first + group_bits(group) / 64;
+    size_t total = 0;
+
+    for (size_t i = first; i < last; ++i) {
+
+        uint64_t bits = mask ? words[i] & mask->words[i] : words[i];
+        total += static_cast<size_t>(__builtin_popcountll(bits));
+
+    }
+
+    return total;
+
+}
+
+
+
+void CoverageMap::save(std::ostream& out, const std::string& name) const {
+
+    // Words are stored little-endian regardless of the host
+    std::vector<unsigned char> bytes(8 + 8 + words.size() * 8);
+    std::copy(COVERAGE_MAGIC, COVERAGE_MAGIC + 8, bytes.begin());
+
+    for (int b = 0; b < 8; ++b) {
+
+        bytes[8 + b] = static_cast<unsigned char>(static_cast<uint64_t>(words.size()) >> (8 * b));
+
+    }
+
+    for (size_t i = 0; i < words.size(); ++i) {
+
+        for (int b = 0; b < 8; ++b) {
+
+            bytes[16 + i * 8 + b] = static_cast<unsigned char>(words[i] >> (8 * b));
+
+        }
+
+    }
+
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    if (!out) {
+
+        throw std::runtime_error(name + ": write failed");
+
+    }
+
+}
+
+
+
+void CoverageMap::save(const char* path) const {
+
+    std::ofstream file(path, std::ios::binary);
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": cannot open for writing");
+
+    }
+
+    save(file, path);
+
+}
+
+
+
+void CoverageMap::load(std::istream& in, const std::string& name) {
+
+    std::vector<unsigned char> bytes(8 + 8 + words.size() * 8);
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    uint64_t stored_words = 0;
+
+    for (int b = 0; b < 8; ++b) {
+
+        stored_words |= static_cast<uint64_t>(bytes[8 + b]) << (8 * b);
+
+    }
+
+    if (!in || !std::equal(COVERAGE_MAGIC, COVERAGE_MAGIC + 8, bytes.begin()) || stored_words != words.size()) {
+
+        throw std::runtime_error(name + ": not a coverage map of this build");
+
+    }
+
+    // Merge rather than replace, so several runs can be accumulated
+    for (size_t i = 0; i < words.size(); ++i) {
+
+        uint64_t word = 0;
+
+        for (int b = 0; b < 8; ++b) {
+
+            word |= static_cast<uint64_t>(bytes[16 + i * 8 + b]) << (8 * b);
+
+        }
+
+        words[i] |= word;
+
+    }
+
+}
+
+
+
+void CoverageMap::load(const char* path) {
+
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+
+        throw std::runtime_error(std::string(path) + ": cannot open");
+
+    }
+
+    load(file, path);
+
+}
+
+
+//-------------------------------------------------
+// Goals and Reports
+//-------------------------------------------------
+
+CoverageMap coverage_goal(const GenConfig& config) {
+
+    CoverageMap goal;
+    RegPool pool = make_reg_pool(config.regs);
+
+    // Sources come from the hot subset only when every roll is hot
+    uint32_t src_mask = pool.hot_threshold >= 256 ? pool.hot_mask : (pool.src_mask | pool.hot_mask);
+
+    for (uint32_t id = 0; id < INSTR_COUNT; ++id) {
+
+        if (!((config.instr_mask >> id) & 1) || !(config.weights[id] > 0)) {
+
+            continue;
+
+        }
+
+        const InstrDesc& desc = instr_table[id];
+        bool memory = desc.instr_class == InstrClass::LOAD || desc.instr_class == InstrClass::STORE;
+        bool uses_rd = desc.format != Format::S && desc.format != Format::B;
+        bool uses_rs1 = desc.format != Format::U && desc.format != Format::J;
+        bool uses_rs2 = desc.format == Format::R || desc.format == Format::S || desc.format == Format::B;
+
+        uint32_t rd_mask = uses_rd ? pool.rd_mask : 1u;
+        uint32_t rs1_mask = uses_rs1 ? (memory ? pool.base_mask : src_mask) : 1u;
+        uint32_t rs2_mask = uses_rs2 ? src_mask : 1u;
+
+        // Register cross bins the constraints can produce
+        for (uint32_t rd = 0; rd < 32; ++rd) {
+
+            for (uint32_t rs1 = 0; rs1 < 32; ++rs1) {
+
+                if (!((rd_mask >> rd) & 1) || !((rs1_mask >> rs1) & 1)) {
+
+                    continue;
+
+                }
+
+                // rd == rs1 only happens when rs1 has no other choice
+                if (pool.rd_ne_rs1 && uses_rd && uses_rs1 && rd == rs1 && (rs1_mask & ~(uint32_t{1} << rd)) != 0) {
+
+                    continue;
+
+                }
+
+                for (uint32_t rs2 = 0; rs2 < 32; ++rs2) {
+
+                    if ((rs2_mask >> rs2) & 1) {
+
+                        goal.set(CROSS_OFFSET + (size_t{id} << 15 | size_t{rd} << 10 | size_t{rs1} << 5 | rs2));
+
+                    }
+
+                }
+
+            }
+
+        }
+
+        for (uint32_t k = 0; k < corner_table.count[id]; ++k) {
+
+            goal.set(CORNER_OFFSET + id * MAX_IMM_CORNERS + k);
+
+        }
+
+        if (desc.instr_class == InstrClass::SHIFT) {
+
+            for (uint32_t shamt = 0; shamt < 32; ++shamt) {
+
+                goal.set(SHAMT_OFFSET + id * 32 + shamt);
+
+            }
+
+        } else if (desc.instr_class == InstrClass::BRANCH) {
+
+            for (uint32_t sign = 0; sign < 3; ++sign) {
+
+                goal.set(SIGN_OFFSET + id * 4 + sign);
+
+            }
+
+        }
+
+    }
+
+    return goal;
+
+}
+
+
+
+CoverageMap measure_coverage(const uint32_t* words, size_t n, unsigned threads) {
+
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(resolve_threads(threads), n / SHARD_SIZE)));
+
+    std::vector<CoverageMap> maps(threads);
+    std::vector<std::thread> pool;
+    size_t slice = (n + threads - 1) / threads;
+
+    // Each thread fills a private map over its slice
+    auto worker = [&](unsigned t) {
+
+        size_t end = std::min(n, (t + 1) * slice);
+
+        for (size_t i = t * slice; i < end; ++i) {
+
+            maps[t].sample_word(words[i]);
+
+        }
+
+    };
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        pool.emplace_back(worker, t);
+
+    }
+
+    worker(0);
+
+    for (std::thread& th : pool) {
+
+        th.join();
+
+    }
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        maps[0].merge(maps[t]);
+
+    }
+
+    return std::move(maps[0]);
+
+}
+
+
+
+void report_coverage(const CoverageMap& map, const CoverageMap& goal, std::ostream& out) {
+
+    size_t covered_total = 0;
+    size_t goal_total = 0;
+
+    auto line = [&](const char* name, size_t covered, size_t bins) {
+
+        out << "coverage " << std::left << std::setw(12) << name << std::right << ": " << covered << " / " << bins
+            << " (" << std::fixed << std::setprecision(2) << (bins ? 100.0 * covered / bins : 100.0) << "%)\n"
+            << std::defaultfloat;
+
+    };
+
+    for (size_t g = 0; g < COVERAGE_GROUP_COUNT; ++g) {
+
+        CoverageGroup group = static_cast<CoverageGroup>(g);
+        size_t covered = map.count(group, &goal);
+        size_t bins = goal.count(group);
+
+        line(coverage_group_name(group), covered, bins);
+        covered_total += covered;
+        goal_total += bins;
+
+    }
+
+    line("total", covered_total, goal_total);
+
+}
+
+
+//-------------------------------------------------
+// Coverage-Driven Generation
+//-------------------------------------------------
+
+CoverageDriver::CoverageDriver(const GenConfig& config, CoverageMap& coverage)
+    : cfg(config), tables(make_gen_tables(config)), goal_map(coverage_goal(config)), cov(coverage),
+      open_words((coverage.word_count() + 63) / 64), rng(config.rng, config.seed, 0) {
+
+    for (size_t g = 0; g < COVERAGE_GROUP_COUNT; ++g) {
+
+        goal_bins += goal_map.count(static_cast<CoverageGroup>(g));
+        covered_bins += cov.count(static_cast<CoverageGroup>(g), &goal_map);
+
+    }
+
+    for (size_t w = 0; w < cov.word_count(); ++w) {
+
+        if (cov.missing(goal_map, w) != 0) {
+
+            open_words[w / 64] |= uint64_t{1} << (w % 64);
+
+        }
+
+    }
+
+}
+
+
+
+size_t CoverageDriver::sample(const InstrRecord& rec) {
+
+    size_t bins[4];
+    size_t n = CoverageMap::bins_of(rec, bins);
+    size_t added = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+
+        if (!cov.test(bins[i])) {
+
+            cov.set(bins[i]);
+            added += goal_map.test(bins[i]);
+
+            // Close the map word once its last missing bin is covered
+            size_t w = bins[i] / 64;
+
+            if (cov.missing(goal_map, w) == 0) {
+
+                open_words[w / 64] &= ~(uint64_t{1} << (w % 64));
+
+            }
+
+        }
+
+    }
+
+    covered_bins += added;
+    return added;
+
+}
+
+
+
+size_t CoverageDriver::find_missing(size_t start) const {
+
+    size_t word = start / 64;
+
+    // Rest of the starting word
+    if (uint64_t bits = cov.missing(goal_map, word) & (~uint64_t{0} << (start % 64))) {
+
+        return word * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+
+    }
+
+    // Then the next open word, scanning the summary and wrapping once
+    size_t n = open_words.size();
+    size_t first = (word + 1) / 64;
+    uint64_t open = first < n ? open_words[first] & (~uint64_t{0} << ((word + 1) % 64)) : 0;
+
+    for (size_t i = 0; i <= n; ++i) {
+
+        if (open != 0) {
+
+            size_t w = ((first + i) % n) * 64 + static_cast<size_t>(__builtin_ctzll(open));
+            return w * 64 + static_cast<size_t>(__builtin_ctzll(cov.missing(goal_map, w)));
+
+        }
+
+        open = open_words[(first + i + 1) % n];
+
+    }
+
+    return CoverageMap::BIT_COUNT;
+
+}
+
+
+
+InstrRecord CoverageDriver::steer(uint64_t word) {
+
+    // Start the search for a missing bin at a random position
+    size_t bin = find_missing(static_cast<size_t>(((word & 0xFFFFFFFF) * CoverageMap::BIT_COUNT) >> 32));
+    uint32_t bits = static_cast<uint32_t>(word >> 32);
+    InstrRecord rec = {0, 0, 0, 0, 0};
+
+    if (bin < CORNER_OFFSET) {
+
+        // A register cross bin fixes everything but the immediate
+        rec.id = static_cast<uint8_t>(bin >> 15);
+        rec.rd = static_cast<uint8_t>((bin >> 10) & 0x1F);
+        rec.rs1 = static_cast<uint8_t>((bin >> 5) & 0x1F);
+        rec.rs2 = static_cast<uint8_t>(bin & 0x1F);
+
+    } else {
+
+        // Other bins fix the instruction; draw its registers as usual
+        if (bin < SHAMT_OFFSET) {
+
+            rec.id = static_cast<uint8_t>((bin - CORNER_OFFSET) / MAX_IMM_CORNERS);
+
+        } else if (bin < SIGN_OFFSET) {
+
+            rec.id = static_cast<uint8_t>((bin - SHAMT_OFFSET) / 32);
+
+        } else {
+
+            rec.id = static_cast<uint8_t>((bin - SIGN_OFFSET) / 4);
+
+        }
+
+        uint64_t reg_word = rng.next();
+        rec.rd = static_cast<uint8_t>((reg_word >> 16) & 0x1F);
+        rec.rs1 = static_cast<uint8_t>((reg_word >> 21) & 0x1F);
+        rec.rs2 = static_cast<uint8_t>((reg_word >> 26) & 0x1F);
+
+        if (tables.regs.active) {
+
+            constrain_registers(rec, reg_word, tables.regs);
+
+        }
+
+    }
+
+    // Use the immediate to fill a missing corner, shamt or sign bin of the
+    // same instruction too, falling back to a random one
+    const InstrDesc& desc = instr_table[rec.id];
+    rec.imm = draw_imm(desc, bits);
+
+    for (uint32_t k = 0; k < corner_table.count[rec.id]; ++k) {
+
+        size_t corner = CORNER_OFFSET + rec.id * MAX_IMM_CORNERS + k;
+
+        if (goal_map.test(corner) && !cov.test(corner)) {
+
+            rec.imm = corner_table.value[rec.id][k];
+            return canonical_record(rec);
+
+        }
+
+    }
+
+    if (desc.instr_class == InstrClass::SHIFT) {
+
+        for (uint32_t shamt = 0; shamt < 32; ++shamt) {
+
+            if (!cov.test(SHAMT_OFFSET + rec.id * 32 + shamt)) {
+
+                rec.imm = static_cast<int32_t>(shamt);
+                break;
+
+            }
+
+        }
+
+    } else if (desc.instr_class == InstrClass::BRANCH) {
+
+        // Negative, zero and positive even offsets within the B-Type range
+        if (!cov.test(SIGN_OFFSET + rec.id * 4 + 0)) {
+
+            rec.imm = -2 - 2 * static_cast<int32_t>(bits % static_cast<uint32_t>(-desc.imm_min / 2));
+
+        } else if (!cov.test(SIGN_OFFSET + rec.id * 4 + 1)) {
+
+            rec.imm = 0;
+
+        } else if (!cov.test(SIGN_OFFSET + rec.id * 4 + 2)) {
+
+            rec.imm = 2 + 2 * static_cast<int32_t>(bits % static_cast<uint32_t>(desc.imm_max / 2));
+
+        }
+
+    }
+
+    return canonical_record(rec);
+
+}
+
+
+
+size_t CoverageDriver::generate(InstrRecord* out, size_t n, double target) {
+
+    if (tables.sampler.count == 0) {
+
+        return 0;
+
+    }
+
+    size_t target_bins = static_cast<size_t>(target * static_cast<double>(goal_bins) + 0.5);
+    size_t i = 0;
+
+    for (; i < n && covered_bins < target_bins; ++i) {
+
+        // Switch to the next shard's stream at shard boundaries
+        if (pos != 0 && pos % SHARD_SIZE == 0) {
+
+            rng = Rng(cfg.rng, cfg.seed, pos / SHARD_SIZE);
+
+        }
+
+        InstrRecord rec = canonical_record(draw_instr(rng, tables, rng.scoreboard()));
+
+        // A draw that covers nothing new is replaced by a steered one
+        if (sample(rec) == 0 && covered_bins < goal_bins) {
+
+            rec = steer(rng.next());
+            sample(rec);
+            steered_count++;
+
+        }
+
+        out[i] = rec;
+        pos++;
+
+    }
+
+    return i;
+
+}
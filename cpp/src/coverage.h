@@ -0,0 +1,256 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "generator.h"
+#include "rng.h"
+
+//-------------------------------------------------
+// Functional Coverage
+//
+// All bins live in one dense bitset, split into 64-bit aligned groups:
+//   cross         instruction x rd x rs1 x rs2 (unused fields are zero)
+//   imm corners   instruction x {0, +1, -1, min, max, sign boundary}
+//   shamt         shift instruction x shamt
+//   branch sign   branch instruction x {negative, zero, positive} offset
+// Sampling a record sets at most four bits, and maps from several threads
+// or runs merge with a bitwise OR.
+//-------------------------------------------------
+
+enum class CoverageGroup : uint8_t { CROSS, IMM_CORNER, SHAMT, BRANCH_SIGN };
+
+constexpr size_t COVERAGE_GROUP_COUNT = 4;
+
+// Corner values tried per instruction (duplicates and out-of-range
+// candidates are dropped, so most instructions have five)
+constexpr size_t MAX_IMM_CORNERS = 8;
+
+namespace coverage_detail {
+
+constexpr size_t round_up_64(size_t bits) {
+
+    return (bits + 63) / 64 * 64;
+
+}
+
+// Bit offset and size of each group
+constexpr size_t CROSS_BITS = INSTR_COUNT << 15;
+constexpr size_t CORNER_BITS = round_up_64(INSTR_COUNT * MAX_IMM_CORNERS);
+constexpr size_t SHAMT_BITS = round_up_64(INSTR_COUNT * 32);
+constexpr size_t SIGN_BITS = round_up_64(INSTR_COUNT * 4);
+
+constexpr size_t CROSS_OFFSET = 0;
+constexpr size_t CORNER_OFFSET = CROSS_OFFSET + CROSS_BITS;
+constexpr size_t SHAMT_OFFSET = CORNER_OFFSET + CORNER_BITS;
+constexpr size_t SIGN_OFFSET = SHAMT_OFFSET + SHAMT_BITS;
+constexpr size_t TOTAL_BITS = SIGN_OFFSET + SIGN_BITS;
+
+// Distinct immediate corner values of every instruction
+struct CornerTable {
+
+    int32_t value[INSTR_COUNT][MAX_IMM_CORNERS];
+    uint8_t count[INSTR_COUNT];
+
+    constexpr CornerTable() : value(), count() {
+
+        for (uint32_t id = 0; id < INSTR_COUNT; ++id) {
+
+            const InstrDesc& desc = instr_table[id];
+            int32_t step = (desc.format == Format::B || desc.format == Format::J) ? 2 : 1;
+
+            if (desc.imm_min == desc.imm_max) {
+
+                continue;
+
+            }
+
+            // Signed fields flip sign between max and min; unsigned fields
+            // (U-Type, shamt) have their sign boundary at the middle
+            int32_t top = desc.imm_max & ~(step - 1);
+            int32_t mid = desc.imm_min < 0 ? desc.imm_min : (desc.imm_max + 1) / 2;
+            const int32_t candidates[] = {0, step, -step, desc.imm_min, top, mid - step, mid};
+
+            for (int32_t v : candidates) {
+
+                bool usable = v >= desc.imm_min && v <= desc.imm_max && (v & (step - 1)) == 0;
+
+                for (uint32_t k = 0; k < count[id]; ++k) {
+
+                    usable = usable && value[id][k] != v;
+
+                }
+
+                if (usable) {
+
+                    value[id][count[id]++] = v;
+
+                }
+
+            }
+
+        }
+
+    }
+
+};
+
+constexpr CornerTable corner_table{};
+
+} // namespace coverage_detail
+
+class CoverageMap {
+
+public:
+
+    static constexpr size_t BIT_COUNT = coverage_detail::TOTAL_BITS;
+
+    CoverageMap() : words(BIT_COUNT / 64) {}
+
+    // Bins hit by a canonical record (see canonical_record()); returns how
+    // many were written to bins[0..4)
+    static size_t bins_of(const InstrRecord& rec, size_t bins[4]) {
+
+        using namespace coverage_detail;
+
+        const InstrDesc& desc = instr_table[rec.id];
+        size_t n = 0;
+
+        bins[n++] = CROSS_OFFSET + (size_t{rec.id} << 15 | size_t{rec.rd} << 10 | size_t{rec.rs1} << 5 | rec.rs2);
+
+        for (uint32_t k = 0; k < corner_table.count[rec.id]; ++k) {
+
+            if (rec.imm == corner_table.value[rec.id][k]) {
+
+                bins[n++] = CORNER_OFFSET + rec.id * MAX_IMM_CORNERS + k;
+                break;
+
+            }
+
+        }
+
+        if (desc.instr_class == InstrClass::SHIFT) {
+
+            bins[n++] = SHAMT_OFFSET + rec.id * 32 + (static_cast<uint32_t>(rec.imm) & 0x1F);
+
+        } else if (desc.instr_class == InstrClass::BRANCH) {
+
+            bins[n++] = SIGN_OFFSET + rec.id * 4 + (rec.imm < 0 ? 0 : rec.imm == 0 ? 1 : 2);
+
+        }
+
+        return n;
+
+    }
+
+    bool test(size_t bin) const { return (words[bin >> 6] >> (bin & 63)) & 1; }
+    void set(size_t bin) { words[bin >> 6] |= uint64_t{1} << (bin & 63); }
+
+    // Record the bins of a canonical record
+    void sample(const InstrRecord& rec) {
+
+        size_t bins[4];
+        size_t n = bins_of(rec, bins);
+
+        for (size_t i = 0; i < n; ++i) {
+
+            set(bins[i]);
+
+        }
+
+    }
+
+    // Record the bins of a machine word; illegal words are ignored
+    void sample_word(uint32_t word);
+
+    void merge(const CoverageMap& other);
+
+    // Set bins of a group, optionally only those also set in mask
+    size_t count(CoverageGroup group, const CoverageMap* mask = nullptr) const;
+
+    // Bins of 64-bit word i that are set in goal but not here
+    uint64_t missing(const CoverageMap& goal, size_t i) const { return goal.words[i] & ~words[i]; }
+    size_t word_count() const { return words.size(); }
+
+    // Binary file: 8-byte magic, 64-bit word count, little-endian words.
+    // load() merges into this map. Both throw std::runtime_error.
+    void save(const char* path) const;
+    void load(const char* path);
+
+    // As above, on a stream already positioned at the map (e.g. inside a
+    // checkpoint); name is used in error messages
+    void save(std::ostream& out, const std::string& name) const;
+    void load(std::istream& in, const std::string& name);
+
+private:
+
+    std::vector<uint64_t> words;
+
+};
+
+const char* coverage_group_name(CoverageGroup group);
+
+// Bins reachable by the stream of config: enabled instructions with a
+// positive weight, and only registers the constraints allow
+CoverageMap coverage_goal(const GenConfig& config);
+
+// Coverage of a word stream, with each thread filling its own map over one
+// slice and the maps merged at the end
+CoverageMap measure_coverage(const uint32_t* words, size_t n, unsigned threads);
+
+// Per-group and total coverage of map against goal
+void report_coverage(const CoverageMap& map, const CoverageMap& goal, std::ostream& out);
+
+// Coverage-driven generation. Draws follow the same per-shard random
+// stream as generate_sharded(), but a draw that adds no new goal bin is
+// replaced by one built from a missing bin found at a random position in
+// the map. The stream is deterministic for a given seed and starting map.
+class CoverageDriver {
+
+public:
+
+    // coverage holds bins already covered (e.g. merged from earlier runs)
+    // and is updated as records are generated
+    CoverageDriver(const GenConfig& config, CoverageMap& coverage);
+
+    // Generate up to n canonical records, stopping early once the covered
+    // fraction of the goal reaches target. Returns the number generated.
+    size_t generate(InstrRecord* out, size_t n, double target);
+
+    double fraction() const { return goal_bins ? static_cast<double>(covered_bins) / goal_bins : 1.0; }
+    uint64_t steered() const { return steered_count; }
+    const CoverageMap& goal() const { return goal_map; }
+
+private:
+
+    // Set a record's bins; returns how many new goal bins it covered
+    size_t sample(const InstrRecord& rec);
+
+    // First missing goal bin at or after start, wrapping around
+    size_t find_missing(size_t start) const;
+
+    InstrRecord steer(uint64_t word);
+
+    GenConfig cfg;
+    GenTables tables;
+    CoverageMap goal_map;
+    CoverageMap& cov;
+
+    // Bit w is set while map word w still has missing goal bins, so the
+    // search for a hole skips covered stretches 64 words at a time
+    std::vector<uint64_t> open_words;
+
+    Rng rng;
+    uint64_t pos = 0;
+    size_t goal_bins = 0;
+    size_t covered_bins = 0;
+    uint64_t steered_count = 0;
+
+};
+
+#endif // COVERAGE_H
@@ -0,0 +1,129 @@
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#include "decoder.h"
+
+//-------------------------------------------------
+// Disassembler
+//-------------------------------------------------
+
+// Register names padded to four bytes so each is a single fixed-size copy
+static constexpr char reg_names[32][4] = {
+    "x0",  "x1",  "x2",  "x3",  "x4",  "x5",  "x6",  "x7",
+    "x8",  "x9",  "x10", "x11", "x12", "x13", "x14", "x15",
+    "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23",
+    "x24", "x25", "x26", "x27", "x28", "x29", "x30", "x31"
+};
+
+static char* put_reg(char* p, uint32_t index) {
+
+    std::memcpy(p, reg_names[index], 4);
+    return p + (index < 10 ? 2 : 3);
+
+}
+
+static char* put_str(char* p, const char* s) {
+
+    while (*s) {
+
+        *p++ = *s++;
+
+    }
+
+    return p;
+
+}
+
+static char* put_sep(char* p) {
+
+    p[0] = ',';
+    p[1] = ' ';
+    return p + 2;
+
+}
+
+template <typename T>
+static char* put_int(char* p, T value) {
+
+    return std::to_chars(p, p + 12, value).ptr;
+
+}
+
+
+
+char* render_instr(const InstrRecord& rec, char* out) {
+
+    const InstrDesc& desc = instr_table[rec.id];
+    char* p = put_str(out, desc.mnemonic);
+    *p++ = ' ';
+
+    // Operand order follows the instruction family, as in the generator
+    switch (desc.instr_class) {
+
+        case InstrClass::UPPER:
+            p = put_sep(put_reg(p, rec.rd));
+            return put_int(p, static_cast<uint32_t>(rec.imm));
+
+        case InstrClass::JUMP:
+            p = put_sep(put_reg(p, rec.rd));
+            return put_int(p, rec.imm);
+
+        case InstrClass::JUMP_REG:
+        case InstrClass::IMMEDIATE:
+        case InstrClass::SHIFT:
+            p = put_sep(put_reg(p, rec.rd));
+            p = put_sep(put_reg(p, rec.rs1));
+            return put_int(p, rec.imm);
+
+        case InstrClass::BRANCH:
+            p = put_sep(put_reg(p, rec.rs1));
+            p = put_sep(put_reg(p, rec.rs2));
+            return put_int(p, rec.imm);
+
+        case InstrClass::LOAD:
+        case InstrClass::STORE:
+            p = put_sep(put_reg(p, desc.instr_class == InstrClass::LOAD ? rec.rd : rec.rs2));
+            p = put_int(p, rec.imm);
+            *p++ = '(';
+            p = put_reg(p, rec.rs1);
+            *p++ = ')';
+            return p;
+
+        case InstrClass::REGISTER:
+            p = put_sep(put_reg(p, rec.rd));
+            p = put_sep(put_reg(p, rec.rs1));
+            return put_reg(p, rec.rs2);
+
+    }
+
+    return p;
+
+}
+
+
+
+std::string format_instr(const InstrRecord& rec) {
+
+    char buf[MAX_ASM_LEN];
+    return std::string(buf, render_instr(rec, buf));
+
+}
+
+
+
+std::string disassemble(uint32_t word) {
+
+    InstrRecord rec;
+
+    if (!decode_instr(word, rec)) {
+
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), ".word 0x%08x", word);
+        return buf;
+
+    }
+
+    return format_instr(rec);
+
+}
@@ -0,0 +1,205 @@
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "instr_table.h"
+
+//-------------------------------------------------
+// Table-Driven Decoder
+//
+// A 512-entry table indexed by opcode[6:2], funct3 and funct7[5] gives the
+// instr_table entry for a word in one lookup; R-Type and shift words then
+// have their full funct7 checked against the descriptor.
+//-------------------------------------------------
+
+// id used for words that are not one of the 37 table instructions
+constexpr uint8_t ILLEGAL_ID = 0xFF;
+
+namespace decoder_detail {
+
+constexpr uint32_t decode_index(uint32_t opcode, uint32_t funct3, uint32_t funct7_bit5) {
+
+    return ((opcode >> 2) << 4) | (funct3 << 1) | funct7_bit5;
+
+}
+
+struct DecodeTable {
+
+    uint8_t id[512];
+
+    constexpr DecodeTable() : id() {
+
+        for (uint8_t& entry : id) {
+
+            entry = ILLEGAL_ID;
+
+        }
+
+        for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+            const InstrDesc& desc = instr_table[i];
+
+            // funct3 is part of the immediate for U/J; funct7[5] only
+            // selects the instruction for R-Type and shifts
+            bool any_funct3 = desc.format == Format::U || desc.format == Format::J;
+            bool uses_funct7 = desc.format == Format::R || desc.instr_class == InstrClass::SHIFT;
+
+            for (uint32_t funct3 = 0; funct3 < 8; ++funct3) {
+
+                for (uint32_t bit5 = 0; bit5 < 2; ++bit5) {
+
+                    if ((any_funct3 || funct3 == desc.funct3) && (!uses_funct7 || bit5 == ((desc.funct7 >> 5) & 1u))) {
+
+                        id[decode_index(desc.opcode, funct3, bit5)] = static_cast<uint8_t>(i);
+
+                    }
+
+                }
+
+            }
+
+        }
+
+    }
+
+};
+
+constexpr DecodeTable decode_table{};
+
+} // namespace decoder_detail
+
+// instr_table index of word, or ILLEGAL_ID
+inline uint8_t decode_id(uint32_t word) {
+
+    if ((word & 0x3) != 0x3) {
+
+        return ILLEGAL_ID;
+
+    }
+
+    uint8_t id = decoder_detail::decode_table.id[decoder_detail::decode_index(word & 0x7F, (word >> 12) & 0x7, (word >> 30) & 0x1)];
+
+    if (id != ILLEGAL_ID) {
+
+        const InstrDesc& desc = instr_table[id];
+
+        if ((desc.format == Format::R || desc.instr_class == InstrClass::SHIFT) && (word >> 25) != desc.funct7) {
+
+            return ILLEGAL_ID;
+
+        }
+
+    }
+
+    return id;
+
+}
+
+// Sign-extend the low `bits` bits of value
+inline int32_t sign_extend(uint32_t value, int bits) {
+
+    uint32_t m = uint32_t{1} << (bits - 1);
+    return static_cast<int32_t>((value ^ m) - m);
+
+}
+
+// Decode word into a record using the generator's field conventions: U-Type
+// imm is the raw 20-bit field, shift imm is the shamt, branch/jump imm is the
+// signed byte offset. Unused fields are zero. Returns false if illegal.
+inline bool decode_instr(uint32_t word, InstrRecord& rec) {
+
+    uint8_t id = decode_id(word);
+
+    if (id == ILLEGAL_ID) {
+
+        return false;
+
+    }
+
+    const InstrDesc& desc = instr_table[id];
+    uint32_t rd = (word >> 7) & 0x1F;
+    uint32_t rs1 = (word >> 15) & 0x1F;
+    uint32_t rs2 = (word >> 20) & 0x1F;
+
+    rec = {id, 0, 0, 0, 0};
+
+    switch (desc.format) {
+
+        case Format::R:
+            rec.rd = static_cast<uint8_t>(rd);
+            rec.rs1 = static_cast<uint8_t>(rs1);
+            rec.rs2 = static_cast<uint8_t>(rs2);
+            break;
+
+        case Format::I:
+            rec.rd = static_cast<uint8_t>(rd);
+            rec.rs1 = static_cast<uint8_t>(rs1);
+            rec.imm = desc.instr_class == InstrClass::SHIFT ? static_cast<int32_t>(rs2) : sign_extend(word >> 20, 12);
+            break;
+
+        case Format::S:
+            rec.rs1 = static_cast<uint8_t>(rs1);
+            rec.rs2 = static_cast<uint8_t>(rs2);
+            rec.imm = sign_extend(((word >> 25) << 5) | ((word >> 7) & 0x1F), 12);
+            break;
+
+        case Format::B:
+            rec.rs1 = static_cast<uint8_t>(rs1);
+            rec.rs2 = static_cast<uint8_t>(rs2);
+            rec.imm = sign_extend(((word >> 31) << 12) | (((word >> 7) & 0x1) << 11) |
+                                  (((word >> 25) & 0x3F) << 5) | (((word >> 8) & 0xF) << 1), 13);
+            break;
+
+        case Format::U:
+            rec.rd = static_cast<uint8_t>(rd);
+            rec.imm = static_cast<int32_t>(word >> 12);
+            break;
+
+        case Format::J:
+            rec.rd = static_cast<uint8_t>(rd);
+            rec.imm = sign_extend(((word >> 31) << 20) | (((word >> 12) & 0xFF) << 12) |
+                                  (((word >> 20) & 0x1) << 11) | (((word >> 21) & 0x3FF) << 1), 21);
+            break;
+
+    }
+
+    return true;
+
+}
+
+// Record with the fields its format does not encode cleared, i.e. the form
+// decode_instr() returns for the record's encoding
+inline InstrRecord canonical_record(InstrRecord rec) {
+
+    switch (instr_table[rec.id].format) {
+
+        case Format::R: rec.imm = 0; break;
+        case Format::I: rec.rs2 = 0; break;
+        case Format::S: rec.rd = 0; break;
+        case Format::B: rec.rd = 0; break;
+        case Format::U: rec.rs1 = 0; rec.rs2 = 0; break;
+        case Format::J: rec.rs1 = 0; rec.rs2 = 0; break;
+
+    }
+
+    return rec;
+
+}
+
+// Longest text render_instr() produces, e.g. "sltiu x31, x31, -2048"
+constexpr size_t MAX_ASM_LEN = 32;
+
+// Render the assembly text of a record at out, without allocating, and
+// return the end of the text. out must have MAX_ASM_LEN bytes of room.
+char* render_instr(const InstrRecord& rec, char* out);
+
+// Assembly text of a record, in the generator's syntax ("lw x5, -4(x2)")
+std::string format_instr(const InstrRecord& rec);
+
+// Assembly text of a machine word; illegal words render as ".word 0x..."
+std::string disassemble(uint32_t word);
+
+#endif // DECODER_H
@@ -0,0 +1,250 @@
+#ifndef ENCODERS_H
+#define ENCODERS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "instr_table.h"
+
+//-------------------------------------------------
+// Encoding Functions
+// Reference: https://riscv.org/wp-content/uploads/2017/05/riscv-spec-v2.2.pdf page: 104-105
+//-------------------------------------------------
+
+// Encode a R-Type instruction
+// Format: funct7[31:25] | rs2[24:20] | rs1[19:15] | funct3[14:12] | rd[11:7] | opcode[6:0]
+constexpr uint32_t encode_R_type(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+
+    return ((funct7 & 0x7F) << 25) |        // funct7 field (7 bits)
+           ((rs2 & 0x1F) << 20)  |          // rs2 field (5 bits)
+           ((rs1 & 0x1F) << 15)  |          // rs1 field (5 bits)
+           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
+           ((rd & 0x1F) << 7)    |          // rd field (5 bits)
+           (opcode & 0x7F);                 // opcode field (7 bits)
+    
+}
+
+
+
+// Encode a I-Type instruction
+// Format: imm[31:20] | rs1[19:15] | funct3[14:12] | rd[11:7] | opcode[6:0]
+constexpr uint32_t encode_I_type(uint32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+
+    return ((imm & 0xFFF) << 20) |          // Immediate field (12 bits)
+            ((rs1 & 0x1F) << 15)  |         // rs1 field (5 bits)
+            ((funct3 & 0x7) << 12) |        // funct3 field (3 bits)
+            ((rd & 0x1F) << 7)    |         // rd field (5 bits)
+            (opcode & 0x7F);                // opcode field (7 bits)
+    
+}
+
+
+
+// Encode a S-Type instruction
+// Format: imm[11:5] | rs2[24:20] | rs1[19:15] | funct3[14:12] | imm[4:0] | opcode[6:0]
+constexpr uint32_t encode_S_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+
+    uint32_t imm11_5 = (imm >> 5) & 0x7F;   // Extract bits [11:5] of immediate
+    uint32_t imm4_0 = imm & 0x1F;           // Extract bits [4:0] of immediate
+
+    return (imm11_5 << 25) |                // imm[11:5] field (7 bits)
+           ((rs2 & 0x1F) << 20) |           // rs2 field (5 bits)
+           ((rs1 & 0x1F) << 15) |           // rs1 field (5 bits)
+           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
+           (imm4_0 << 7) |                  // imm[4:0] field (5 bits)
+           (opcode & 0x7F);                 // opcode field (7 bits)
+    
+}
+
+
+
+// Encode a B-Type instruction
+// Format: imm[12|10:5] | rs2[24:20] | rs1[19:15] | funct3[14:12] | imm[4:1|11] | opcode[6:0]
+constexpr uint32_t encode_B_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+
+    uint32_t imm12 = (imm >> 12) & 0x1;     // Extract bit 12
+    uint32_t imm10_5 = (imm >> 5) & 0x3F;   // Extract bits [10:5]
+    uint32_t imm4_1 = (imm >> 1) & 0xF;     // Extract bits [4:1]
+    uint32_t imm11 = (imm >> 11) & 0x1;     // Extract bit 11
+
+    return (imm12 << 31) |                  // imm[12] field (1 bit)
+           (imm10_5 << 25) |                // imm[10:5] field (6 bits)
+           ((rs2 & 0x1F) << 20) |           // rs2 field (5 bits)
+           ((rs1 & 0x1F) << 15) |           // rs1 field (5 bits)
+           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
+           (imm4_1 << 8) |                  // imm[4:1] field (4 bits)
+           (imm11 << 7) |                   // imm[11] field (1 bit)
+           (opcode & 0x7F);                 // opcode field (7 bits)
+    
+}
+
+
+
+// Encode a U-Type instruction
+// Format: imm[31:12] | rd[11:7] | opcode[6:0]
+constexpr uint32_t encode_U_type(uint32_t imm, uint32_t rd, uint32_t opcode) {
+
+    return ((imm & 0xFFFFF) << 12) |        // Immediate field (20 bits)
+           ((rd & 0x1F) << 7) |             // rd field (5 bits)
+           (opcode & 0x7F);                 // opcode field (7 bits)
+    
+}
+
+
+
+// Encode a J-Type instruction
+// Format: imm[20|10:1|11|19:12] | rd[11:7] | opcode[6:0]
+constexpr uint32_t encode_J_type(uint32_t imm, uint32_t rd, uint32_t opcode) {
+
+    uint32_t imm20 = (imm >> 20) & 0x1;         // Extract bit 20
+    uint32_t imm10_1 = (imm >> 1) & 0x3FF;      // Extract bits [10:1]
+    uint32_t imm11 = (imm >> 11) & 0x1;         // Extract bit 11
+    uint32_t imm19_12 = (imm >> 12) & 0xFF;     // Extract bits [19:12]
+
+    return (imm20 << 31) |                      // imm[20] field (1 bit)
+           (imm19_12 << 12) |                   // imm[19:12] field (8 bits)
+           (imm11 << 20) |                      // imm[11] field (1 bit)
+           (imm10_1 << 21) |                    // imm[10:1] field (10 bits)
+           ((rd & 0x1F) << 7) |                 // rd field (5 bits)
+           (opcode & 0x7F);                     // opcode field (7 bits)
+    
+}
+
+
+
+// Encode any table instruction from its descriptor and operand fields. For
+// shifts imm is the shamt and funct7 is merged into the immediate field.
+inline uint32_t encode_instr(const InstrDesc& desc, uint32_t rd, uint32_t rs1, uint32_t rs2, int32_t imm) {
+
+    uint32_t uimm = static_cast<uint32_t>(imm);
+
+    switch (desc.format) {
+
+        case Format::R: return encode_R_type(desc.funct7, rs2, rs1, desc.funct3, rd, desc.opcode);
+        case Format::I:
+            if (desc.instr_class == InstrClass::SHIFT) {
+                uimm = (static_cast<uint32_t>(desc.funct7) << 5) | (uimm & 0x1F);
+            }
+            return encode_I_type(uimm, rs1, desc.funct3, rd, desc.opcode);
+        case Format::S: return encode_S_type(uimm, rs2, rs1, desc.funct3, desc.opcode);
+        case Format::B: return encode_B_type(uimm, rs2, rs1, desc.funct3, desc.opcode);
+        case Format::U: return encode_U_type(uimm, rd, desc.opcode);
+        case Format::J: return encode_J_type(uimm, rd, desc.opcode);
+
+    }
+
+    return 0;
+
+}
+
+
+
+//-------------------------------------------------
+// Compile-Time Specialised Encoders
+//
+// Gen<Format, opcode, funct3, funct7> knows every fixed field of one
+// instruction at compile time: they are pre-packed into MATCH, so encoding
+// is a single OR of MATCH with the operand fields and every mask and shift
+// folds into a constant. The encoder table instantiates one Gen per
+// instr_table entry.
+//-------------------------------------------------
+
+template <Format F, uint32_t Opcode, uint32_t Funct3 = 0, uint32_t Funct7 = 0>
+struct Gen {
+
+    // Shifts are the I-Type immediates with funct3 = x01; funct7 sits above the shamt
+    static constexpr bool SHIFT = F == Format::I && Opcode == OPCODE_IMMEDIATE && (Funct3 & 0x3) == 0b01;
+
+    // Fixed bits: opcode, funct3 (not in U/J) and funct7 (R-Type and shifts)
+    static constexpr uint32_t MATCH = Opcode |
+                                      (F == Format::U || F == Format::J ? 0 : Funct3 << 12) |
+                                      (F == Format::R || SHIFT ? Funct7 << 25 : 0);
+
+    static_assert(Opcode <= 0x7F && Funct3 <= 0x7 && Funct7 <= 0x7F, "field out of range");
+
+    static constexpr uint32_t encode(uint32_t rd, uint32_t rs1, uint32_t rs2, int32_t imm) {
+
+        uint32_t uimm = static_cast<uint32_t>(imm);
+
+        if constexpr (F == Format::R) {
+            return MATCH | encode_R_type(0, rs2, rs1, 0, rd, 0);
+        } else if constexpr (F == Format::I && SHIFT) {
+            return MATCH | encode_I_type(uimm & 0x1F, rs1, 0, rd, 0);
+        } else if constexpr (F == Format::I) {
+            return MATCH | encode_I_type(uimm, rs1, 0, rd, 0);
+        } else if constexpr (F == Format::S) {
+            return MATCH | encode_S_type(uimm, rs2, rs1, 0, 0);
+        } else if constexpr (F == Format::B) {
+            return MATCH | encode_B_type(uimm, rs2, rs1, 0, 0);
+        } else if constexpr (F == Format::U) {
+            return MATCH | encode_U_type(uimm, rd, 0);
+        } else {
+            return MATCH | encode_J_type(uimm, rd, 0);
+        }
+
+    }
+
+};
+
+// Specialised encoder of instr_table[Id]
+template <size_t Id>
+using GenFor = Gen<instr_table[Id].format, instr_table[Id].opcode, instr_table[Id].funct3, instr_table[Id].funct7>;
+
+using EncodeFn = uint32_t (*)(uint32_t rd, uint32_t rs1, uint32_t rs2, int32_t imm);
+
+template <size_t... Ids>
+constexpr std::array<EncodeFn, sizeof...(Ids)> make_instr_encoders(std::index_sequence<Ids...>) {
+
+    return {{&GenFor<Ids>::encode...}};
+
+}
+
+// Encoder per InstrId, built from the instruction list at compile time
+constexpr std::array<EncodeFn, INSTR_COUNT> instr_encoders = make_instr_encoders(std::make_index_sequence<INSTR_COUNT>{});
+
+// Encode a drawn record with its instruction's specialised encoder
+inline uint32_t encode_record(const InstrRecord& rec) {
+
+    return instr_encoders[rec.id](rec.rd, rec.rs1, rec.rs2, rec.imm);
+
+}
+
+
+
+// MATCH values from the RISC-V opcode map (riscv-opcodes), in InstrId order
+constexpr uint32_t spec_match[] = {
+    0x00000037, 0x00000017, 0x0000006F, 0x00000067,                                     // lui auipc jal jalr
+    0x00000063, 0x00001063, 0x00004063, 0x00005063, 0x00006063, 0x00007063,             // beq bne blt bge bltu bgeu
+    0x00000003, 0x00001003, 0x00002003, 0x00004003, 0x00005003,                         // lb lh lw lbu lhu
+    0x00000023, 0x00001023, 0x00002023,                                                 // sb sh sw
+    0x00000013, 0x00002013, 0x00003013, 0x00004013, 0x00006013, 0x00007013,             // addi slti sltiu xori ori andi
+    0x00001013, 0x00005013, 0x40005013,                                                 // slli srli srai
+    0x00000033, 0x40000033, 0x00001033, 0x00002033, 0x00003033,                         // add sub sll slt sltu
+    0x00004033, 0x00005033, 0x40005033, 0x00006033, 0x00007033                          // xor srl sra or and
+};
+
+static_assert(sizeof(spec_match) / sizeof(spec_match[0]) == INSTR_COUNT, "spec_match must cover instr_table");
+
+template <size_t... Ids>
+constexpr bool gen_matches_spec(std::index_sequence<Ids...>) {
+
+    return ((GenFor<Ids>::MATCH == spec_match[Ids]) && ...);
+
+}
+
+static_assert(gen_matches_spec(std::make_index_sequence<INSTR_COUNT>{}), "specialised encoder fixed bits differ from the RISC-V opcode map");
+
+// Operand packing, checked against assembler output
+static_assert(GenFor<ID_LUI>::encode(5, 0, 0, 0x12345) == 0x123452B7, "lui x5, 0x12345");
+static_assert(GenFor<ID_JAL>::encode(1, 0, 0, 2048) == 0x001000EF, "jal x1, 2048");
+static_assert(GenFor<ID_BEQ>::encode(0, 1, 2, -4) == 0xFE208EE3, "beq x1, x2, -4");
+static_assert(GenFor<ID_BEQ>::encode(0, 1, 2, 2048) == 0x002080E3, "beq x1, x2, 2048");
+static_assert(GenFor<ID_BEQ>::encode(0, 1, 2, -2050) == 0xFE208F63, "beq x1, x2, -2050");
+static_assert(GenFor<ID_SW>::encode(0, 1, 2, 8) == 0x0020A423, "sw x2, 8(x1)");
+static_assert(GenFor<ID_ADDI>::encode(1, 0, 0, 1) == 0x00100093, "addi x1, x0, 1");
+static_assert(GenFor<ID_SRAI>::encode(5, 6, 0, 3) == 0x40335293, "srai x5, x6, 3");
+static_assert(GenFor<ID_SUB>::encode(3, 1, 2, 0) == 0x402081B3, "sub x3, x1, x2");
+
+#endif // ENCODERS_H
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+
+#include "generator.h"
+#include "encoders.h"
+#include "stats.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+GenTables make_gen_tables(const GenConfig& config) {
+
+    RegPool regs = make_reg_pool(config.regs);
+
+    return {make_sampler(config.instr_mask, config.weights), regs, make_hazard_table(config.hazards, regs)};
+
+}
+
+
+
+// Instructions per block of the batch loop; with GEN_STATS each block's
+// drawing and encoding are timed as a whole, a few clock reads per block
+constexpr size_t FILL_BLOCK = 256;
+
+// Batch loop specialised on the concrete engine
+template <typename Engine>
+static void fill_batch(uint32_t* out, size_t n, const GenTables& tables, Engine& engine, Scoreboard& board) {
+
+    // Local copies stay in registers across the stores to out
+    Engine local = engine;
+    Scoreboard scoreboard = board;
+    InstrRecord records[FILL_BLOCK];
+    ThreadStats& stats = thread_stats();
+
+    for (size_t i = 0; i < n; i += FILL_BLOCK) {
+
+        size_t m = std::min(FILL_BLOCK, n - i);
+        uint64_t t0 = stats_ticks();
+
+        for (size_t k = 0; k < m; ++k) {
+
+            records[k] = draw_instr(local, tables, scoreboard);
+
+        }
+
+        uint64_t t1 = stats_ticks();
+
+        for (size_t k = 0; k < m; ++k) {
+
+            out[i + k] = encode_record(records[k]);
+
+        }
+
+        uint64_t t2 = stats_ticks();
+
+        stats_count_instrs(stats, records, m);
+        stats_add_stage(stats, Stage::SELECT, t1 - t0, m);
+        stats_add_stage(stats, Stage::ENCODE, t2 - t1, m);
+
+    }
+
+    engine = local;
+    board = scoreboard;
+
+}
+
+
+
+template <typename Engine>
+static void fill_records(InstrRecord* out, size_t n, const GenTables& tables, Engine& engine, Scoreboard& board) {
+
+    for (size_t i = 0; i < n; ++i) {
+
+        out[i] = draw_instr(engine, tables, board);
+
+    }
+
+}
+
+
+
+size_t generate_batch(uint32_t* out, size_t n, const GenConfig& config, Rng& rng) {
+
+    GenTables tables = make_gen_tables(config);
+
+    if (tables.sampler.count == 0) {
+
+        return 0;
+
+    }
+
+#if GEN_STATS
+    auto start = std::chrono::steady_clock::now();
+#endif
+
+    switch (rng.kind()) {
+
+        case RngKind::XOSHIRO: fill_batch(out, n, tables, rng.xoshiro(), rng.scoreboard()); break;
+        case RngKind::PHILOX:  fill_batch(out, n, tables, rng.philox(), rng.scoreboard()); break;
+
+    }
+
+#if GEN_STATS
+    stats_record_batch(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+#endif
+
+    return n;
+
+}
+
+
+
+size_t generate_records(InstrRecord* out, size_t n, const GenConfig& config, Rng& rng) {
+
+    GenTables tables = make_gen_tables(config);
+
+    if (tables.sampler.count == 0) {
+
+        return 0;
+
+    }
+
+    {
+        StageTimer timer(Stage::SELECT, n);
+
+        switch (rng.kind()) {
+
+            case RngKind::XOSHIRO: fill_records(out, n, tables, rng.xoshiro(), rng.scoreboard()); break;
+            case RngKind::PHILOX:  fill_records(out, n, tables, rng.philox(), rng.scoreboard()); break;
+
+        }
+    }
+
+    stats_count_instrs(thread_stats(), out, n);
+
+    return n;
+
+}
+
+
+
+size_t generate_batch(uint32_t* out, size_t n, const GenConfig& config) {
+
+    Rng rng(config.rng, config.seed);
+
+    return generate_batch(out, n, config, rng);
+
+}
@@ -0,0 +1,154 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hazard.h"
+#include "instr_table.h"
+#include "mix.h"
+#include "reg_pool.h"
+#include "rng.h"
+
+//-------------------------------------------------
+// Batch Generation
+//-------------------------------------------------
+
+// Every instruction in instr_table enabled
+constexpr uint64_t ALL_INSTRS = (uint64_t{1} << INSTR_COUNT) - 1;
+
+struct GenConfig {
+
+    // Bit i enables instr_table[i]; disabled instructions are never drawn
+    uint64_t instr_mask = ALL_INSTRS;
+
+    // Relative weight of each instr_table entry (see mix.h)
+    InstrWeights weights = uniform_weights();
+
+    // Register selection constraints (see reg_pool.h)
+    RegConstraints regs;
+
+    // Dependency-distance shaping (see hazard.h)
+    HazardConfig hazards;
+
+    // Engine and seed used when generate_batch creates its own generator
+    RngKind rng = RngKind::XOSHIRO;
+    uint64_t seed = 0;
+
+};
+
+// Scale 32 random bits onto [imm_min, imm_max] of an instruction
+inline int32_t draw_imm(const InstrDesc& desc, uint32_t bits32) {
+
+    uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(desc.imm_max) - desc.imm_min) + 1;
+    int32_t imm = desc.imm_min + static_cast<int32_t>((bits32 * span) >> 32);
+
+    // Branch and jump offsets must be even; the B/J encodings have no bit 0
+    if (desc.format == Format::B || desc.format == Format::J) {
+
+        imm &= ~0x1;
+
+    }
+
+    return imm;
+
+}
+
+// Split one 64-bit random word into an instruction record:
+//   [15:0]  instruction select     [30:26] rs2
+//   [20:16] rd                     [63:32] immediate
+//   [25:21] rs1
+inline InstrRecord draw_record(uint64_t word, const InstrSampler& sampler) {
+
+    InstrRecord rec;
+
+    // Pick the instruction from the mix's alias table
+    rec.id = sampler.sample(static_cast<uint32_t>(word & 0xFFFF));
+    rec.rd = static_cast<uint8_t>((word >> 16) & 0x1F);
+    rec.rs1 = static_cast<uint8_t>((word >> 21) & 0x1F);
+    rec.rs2 = static_cast<uint8_t>((word >> 26) & 0x1F);
+    rec.imm = draw_imm(instr_table[rec.id], static_cast<uint32_t>(word >> 32));
+
+    return rec;
+
+}
+
+// Redraw a record's registers from the constrained pool using a second
+// random word:
+//   [15:0]  rd         [39:32] rs1 hot roll
+//   [31:16] rs1        [55:40] rs2            [63:56] rs2 hot roll
+inline void constrain_registers(InstrRecord& rec, uint64_t word, const RegPool& pool) {
+
+    InstrClass instr_class = instr_table[rec.id].instr_class;
+    bool memory = instr_class == InstrClass::LOAD || instr_class == InstrClass::STORE;
+
+    rec.rd = select_register(pool.rd_set, static_cast<uint32_t>(word & 0xFFFF));
+
+    // Sources come from the hot subset when their roll is under the threshold
+    bool rs1_hot = static_cast<uint32_t>((word >> 32) & 0xFF) < pool.hot_threshold;
+    bool rs2_hot = static_cast<uint32_t>(word >> 56) < pool.hot_threshold;
+    const RegSet& rs1_set = memory ? pool.base_set : (rs1_hot ? pool.hot_set : pool.src_set);
+    const RegSet& rs2_set = rs2_hot ? pool.hot_set : pool.src_set;
+    uint32_t rs1_bits = static_cast<uint32_t>((word >> 16) & 0xFFFF);
+
+    // Keep rs1 off rd unless that would leave nothing to choose from
+    rec.rs1 = pool.rd_ne_rs1 ? select_register_except(rs1_set, rec.rd, rs1_bits) : select_register(rs1_set, rs1_bits);
+    rec.rs2 = select_register(rs2_set, static_cast<uint32_t>((word >> 40) & 0xFFFF));
+
+}
+
+// Lookup tables derived from a GenConfig, built once per batch
+struct GenTables {
+    InstrSampler sampler;
+    RegPool regs;
+    HazardTable hazards;
+};
+
+GenTables make_gen_tables(const GenConfig& config);
+
+// Random words each instruction takes: one, plus one when register
+// constraints are active and one more when hazard shaping is
+inline size_t draws_per_instr(const GenTables& tables) {
+
+    return 1 + tables.regs.active + tables.hazards.active;
+
+}
+
+// Draw one complete instruction record: one random word, a second when
+// register constraints are active and a third for hazard shaping against
+// the stream's scoreboard. Always inlined, so batch loops keep the engine
+// and scoreboard in registers.
+template <typename Engine>
+[[gnu::always_inline]] inline InstrRecord draw_instr(Engine& engine, const GenTables& tables, Scoreboard& board) {
+
+    InstrRecord rec = draw_record(engine.next(), tables.sampler);
+
+    if (tables.regs.active) {
+
+        constrain_registers(rec, engine.next(), tables.regs);
+
+    }
+
+    if (tables.hazards.active) {
+
+        shape_hazards(rec, engine.next(), tables.hazards, tables.regs, board);
+
+    }
+
+    return rec;
+
+}
+
+// Fill out[0..n) with random encodings, continuing the caller's generator.
+// Only the 32-bit machine words are produced: no assembly text is built and
+// nothing is allocated. Returns the number of words written (0 if the config
+// enables no instructions).
+size_t generate_batch(uint32_t* out, size_t n, const GenConfig& config, Rng& rng);
+
+// Fill out[0..n) with the records generate_batch would encode
+size_t generate_records(InstrRecord* out, size_t n, const GenConfig& config, Rng& rng);
+
+// As generate_batch above, with a fresh generator seeded from config.rng and config.seed
+size_t generate_batch(uint32_t* out, size_t n, const GenConfig& config);
+
+#endif // GENERATOR_H
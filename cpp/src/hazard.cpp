@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hazard.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+HazardTable make_hazard_table(const HazardConfig& config, const RegPool& pool) {
+
+    HazardTable table;
+    uint32_t total = 0;
+
+    for (uint32_t percent : config.raw_percent) {
+
+        total += percent;
+
+    }
+
+    if (total > 100 || config.load_use_percent > 100 || config.waw_percent > 100) {
+
+        throw std::invalid_argument("hazard percentages exceed 100");
+
+    }
+
+    // Consecutive runs of the 1024 rolls, one per distance, sized by percent
+    size_t roll = 0;
+    uint32_t cumulative = 0;
+
+    for (size_t d = 0; d < MAX_HAZARD_DISTANCE; ++d) {
+
+        cumulative += config.raw_percent[d];
+        size_t end = cumulative * 1024 / 100;
+
+        for (; roll < end; ++roll) {
+
+            table.raw_pick[roll] = static_cast<uint16_t>(0xFF00 | (8 * d));
+
+        }
+
+    }
+
+    uint32_t src_mask = (pool.src_mask | pool.hot_mask) & ~1u;
+
+    for (size_t id = 0; id < INSTR_COUNT; ++id) {
+
+        const InstrDesc& desc = instr_table[id];
+        bool reads_rs1 = desc.format != Format::U && desc.format != Format::J;
+        bool reads_rs2 = desc.format == Format::R || desc.format == Format::S || desc.format == Format::B;
+        bool writes_rd = !reads_rs2 || desc.format == Format::R;
+        bool memory = desc.instr_class == InstrClass::LOAD || desc.instr_class == InstrClass::STORE;
+
+        table.operands[id] = static_cast<uint8_t>((writes_rd ? WRITES_RD : 0) | (desc.instr_class == InstrClass::LOAD ? LOAD : 0));
+        table.rs1_mask[id] = reads_rs1 ? (memory ? pool.base_mask & ~1u : src_mask) : 0;
+        table.rs2_mask[id] = reads_rs2 ? src_mask : 0;
+        table.waw_mask[id] = writes_rd ? pool.rd_mask & ~1u : 0;
+
+    }
+
+    table.load_use_threshold = config.load_use_percent * 65536 / 100;
+    table.waw_threshold = config.waw_percent * 65536 / 100;
+    table.active = total > 0 || config.load_use_percent > 0 || config.waw_percent > 0;
+
+    return table;
+
+}
+
+
+
+bool parse_raw_distances(const char* list, HazardConfig& config) {
+
+    // Comma-separated distance:percent pairs, e.g. "1:30,2:10"
+    config.raw_percent = {};
+
+    for (const char* p = list; *p; ) {
+
+        char* end;
+        unsigned long distance = std::strtoul(p, &end, 10);
+
+        if (end == p || *end != ':' || distance < 1 || distance > MAX_HAZARD_DISTANCE) {
+
+            return false;
+
+        }
+
+        p = end + 1;
+        unsigned long percent = std::strtoul(p, &end, 10);
+
+        if (end == p || percent > 100 || (*end != ',' && *end != '\0')) {
+
+            return false;
+
+        }
+
+        config.raw_percent[distance - 1] = static_cast<uint32_t>(percent);
+        p = (*end == ',') ? end + 1 : end;
+
+    }
+
+    return true;
+
+}
+
+
+
+void report_hazards(const GenConfig& config, uint64_t count, std::ostream& out) {
+
+    // Index of the last instruction writing each register, -1 if none
+    int64_t written_at[32];
+    std::fill(std::begin(written_at), std::end(written_at), -1);
+
+    uint64_t distance[MAX_HAZARD_DISTANCE + 1] = {};
+    uint64_t sources = 0;
+    uint64_t after_load = 0;
+    uint64_t load_use = 0;
+    uint64_t after_write = 0;
+    uint64_t waw = 0;
+    uint32_t last_rd = 0;
+    bool last_load = false;
+
+    std::vector<InstrRecord> chunk(SHARD_SIZE);
+    int64_t index = 0;
+
+    for (uint64_t shard = 0; static_cast<uint64_t>(index) < count; ++shard) {
+
+        Rng rng(config.rng, config.seed, shard);
+        size_t n = static_cast<size_t>(std::min<uint64_t>(SHARD_SIZE, count - static_cast<uint64_t>(index)));
+        generate_records(chunk.data(), n, config, rng);
+
+        for (size_t i = 0; i < n; ++i, ++index) {
+
+            const InstrRecord& rec = chunk[i];
+            const InstrDesc& desc = instr_table[rec.id];
+            bool reads_rs1 = desc.format != Format::U && desc.format != Format::J;
+            bool reads_rs2 = desc.format == Format::R || desc.format == Format::S || desc.format == Format::B;
+            bool writes_rd = (!reads_rs2 || desc.format == Format::R) && rec.rd != 0;
+
+            auto source = [&](uint32_t reg) {
+
+                if (reg == 0) {
+
+                    return;
+
+                }
+
+                ++sources;
+                int64_t d = written_at[reg] < 0 ? 0 : index - written_at[reg];
+                ++distance[d >= 1 && d <= static_cast<int64_t>(MAX_HAZARD_DISTANCE) ? d : 0];
+
+            };
+
+            if (reads_rs1) {
+
+                source(rec.rs1);
+
+            }
+
+            if (reads_rs2) {
+
+                source(rec.rs2);
+
+            }
+
+            if (last_load) {
+
+                ++after_load;
+                load_use += (reads_rs1 && rec.rs1 == last_rd) || (reads_rs2 && rec.rs2 == last_rd);
+
+            }
+
+            if (writes_rd && last_rd != 0) {
+
+                ++after_write;
+                waw += rec.rd == last_rd;
+
+            }
+
+            last_rd = writes_rd ? rec.rd : 0;
+            last_load = writes_rd && desc.instr_class == InstrClass::LOAD;
+
+            if (writes_rd) {
+
+                written_at[rec.rd] = index;
+
+            }
+
+        }
+
+    }
+
+    auto line = [&](const std::string& name, uint64_t hits, uint64_t total, const char* of) {
+
+        out << "hazard " << std::left << std::setw(10) << name << std::right << ": " << std::fixed << std::setprecision(2)
+            << (total ? 100.0 * hits / total : 0.0) << "% of " << of << "\n" << std::defaultfloat;
+
+    };
+
+    for (size_t d = 1; d <= MAX_HAZARD_DISTANCE; ++d) {
+
+        line("raw d=" + std::to_string(d), distance[d], sources, "sources");
+
+    }
+
+    line("raw d>" + std::to_string(MAX_HAZARD_DISTANCE), distance[0], sources, "sources");
+    line("load-use", load_use, after_load, "instructions after a load");
+    line("waw", waw, after_write, "writes after a write");
+
+}
@@ -0,0 +1,153 @@
+#ifndef HAZARD_H
+#define HAZARD_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "instr_table.h"
+#include "reg_pool.h"
+#include "rng.h"
+
+//-------------------------------------------------
+// Hazard Shaping
+//
+// Independent register draws rarely read a register written one or two
+// instructions earlier, and those short distances are the ones that exercise
+// forwarding and stall logic. With shaping on, every instruction takes one
+// more random word:
+//   [9:0]   rs1 distance roll      [47:32] load-use roll
+//   [25:16] rs2 distance roll      [63:48] WAW roll
+// Each roll picks a source's dependency distance from the requested
+// distribution. The source is then redirected to the destination the
+// Scoreboard holds for that distance: one shift and one mask.
+//-------------------------------------------------
+
+// Longest dependency distance the scoreboard remembers
+constexpr size_t MAX_HAZARD_DISTANCE = 8;
+
+struct HazardConfig {
+
+    // Percent of register sources that read the destination written d
+    // instructions earlier, at index d - 1; the total must not exceed 100.
+    // Stores, branches and writes outside the source masks leave nothing
+    // to read, so the achieved share is somewhat lower.
+    std::array<uint32_t, MAX_HAZARD_DISTANCE> raw_percent{};
+
+    // Percent of instructions right after a load whose first source reads
+    // the loaded register (taking precedence over raw_percent)
+    uint32_t load_use_percent = 0;
+
+    // Percent of instructions whose rd repeats the previous destination
+    uint32_t waw_percent = 0;
+
+};
+
+// Operand flags of each instruction, in HazardTable::operands
+enum HazardOperand : uint8_t {
+    WRITES_RD = 1,
+    LOAD      = 2,
+};
+
+// Thresholds derived from HazardConfig, and the register pool's masks
+// folded per instruction so that shaping needs no per-format decisions
+struct HazardTable {
+
+    // False when no hazard is requested; the stream is then unchanged
+    bool active = false;
+
+    // HazardOperand flags per instruction id
+    uint8_t operands[INSTR_COUNT] = {};
+
+    // Registers each source may be redirected to, per instruction id: the
+    // pool's mask for that operand, or 0 where the instruction has no such
+    // source
+    uint32_t rs1_mask[INSTR_COUNT] = {};
+    uint32_t rs2_mask[INSTR_COUNT] = {};
+
+    // Registers rd may repeat from the previous instruction, or 0 where the
+    // instruction writes no register
+    uint32_t waw_mask[INSTR_COUNT] = {};
+
+    // Per 10-bit roll, the scoreboard shift of the chosen distance in the
+    // low byte and 0xFF in the high byte, or 0 for no hazard
+    uint16_t raw_pick[1024] = {};
+
+    // A 16-bit roll below these applies the hazard
+    uint32_t load_use_threshold = 0;
+    uint32_t waw_threshold = 0;
+
+};
+
+// Throws std::invalid_argument if the RAW percentages exceed 100 in total
+// or either of the other two does. None of the masks contains x0, which no
+// hazard may go through.
+HazardTable make_hazard_table(const HazardConfig& config, const RegPool& pool = RegPool());
+
+// Parse "1:30,2:10,4:5" (distance:percent pairs) into raw_percent
+bool parse_raw_distances(const char* list, HazardConfig& config);
+
+// Redirect a drawn record's operands to create the requested hazards
+// against board, within the register pool's masks, then record its
+// destination in board
+[[gnu::always_inline]] inline void shape_hazards(InstrRecord& rec, uint64_t word, const HazardTable& table, const RegPool& pool, Scoreboard& board) {
+
+    // Every roll is random, so each choice on one is a mask select rather
+    // than a branch the predictor would miss; the branches below only test
+    // the configuration, which is the same for the whole batch
+    uint32_t ops = table.operands[rec.id];
+    uint64_t dest = board.dest;
+    uint32_t last = static_cast<uint32_t>(dest & 0xFF);
+    uint32_t rd = rec.rd;
+
+    // WAW first, so the source checks below see the final rd
+    if (table.waw_threshold != 0) {
+
+        uint32_t waw = 0u - ((table.waw_mask[rec.id] >> last) & (static_cast<uint32_t>(word >> 48) < table.waw_threshold) &
+                             ~(pool.rd_ne_rs1 & (last == rec.rs1)) & 1);
+        rd = (last & waw) | (rd & ~waw);
+
+    }
+
+    // Distance 0 (no hazard) selects x0, which the masks reject
+    uint32_t pick1 = table.raw_pick[word & 0x3FF];
+    uint32_t pick2 = table.raw_pick[(word >> 16) & 0x3FF];
+    uint32_t reg1 = static_cast<uint32_t>(dest >> (pick1 & 0xFF)) & (pick1 >> 8);
+    uint32_t reg2 = static_cast<uint32_t>(dest >> (pick2 & 0xFF)) & (pick2 >> 8);
+
+    // Load-use overrides rs1's distance with the loaded register
+    if (table.load_use_threshold != 0) {
+
+        uint32_t load_use = 0u - (board.last_load & (static_cast<uint32_t>((word >> 32) & 0xFFFF) < table.load_use_threshold));
+        reg1 = (last & load_use) | (reg1 & ~load_use);
+
+    }
+
+    uint32_t take1 = (table.rs1_mask[rec.id] >> reg1) & 1;
+    uint32_t take2 = (table.rs2_mask[rec.id] >> reg2) & 1;
+
+    if (pool.rd_ne_rs1) {
+
+        take1 &= ~((ops & WRITES_RD) & (reg1 == rd));
+
+    }
+
+    take1 = 0u - take1;
+    take2 = 0u - take2;
+    rec = InstrRecord{rec.id, static_cast<uint8_t>(rd), static_cast<uint8_t>((reg1 & take1) | (rec.rs1 & ~take1)),
+                      static_cast<uint8_t>((reg2 & take2) | (rec.rs2 & ~take2)), rec.imm};
+
+    board.dest = dest << 8 | (rd & (0u - (ops & WRITES_RD)));
+    board.last_load = (ops >> 1) & (rd != 0);
+
+}
+
+struct GenConfig;
+
+// Replay the first count instructions of config's stream and print, per
+// distance, the share of register sources whose nearest earlier writer is
+// that many instructions back, plus the load-use and WAW rates
+void report_hazards(const GenConfig& config, uint64_t count, std::ostream& out);
+
+#endif // HAZARD_H
@@ -0,0 +1,129 @@
+#ifndef INSTR_TABLE_H
+#define INSTR_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//-------------------------------------------------
+// RV32I Instruction Descriptors
+// Reference: https://riscv.org/wp-content/uploads/2017/05/riscv-spec-v2.2.pdf page: 104-105
+//-------------------------------------------------
+
+// Encoding format of an instruction
+enum class Format : uint8_t { R, I, S, B, U, J };
+
+// Generator family of an instruction; selects the operand layout and the
+// assembly syntax (several families share the I-Type format)
+enum class InstrClass : uint8_t {
+    UPPER,          // lui, auipc
+    JUMP,           // jal
+    JUMP_REG,       // jalr
+    BRANCH,         // beq, bne, blt, bge, bltu, bgeu
+    LOAD,           // lb, lh, lw, lbu, lhu
+    STORE,          // sb, sh, sw
+    IMMEDIATE,      // addi, slti, sltiu, xori, ori, andi
+    SHIFT,          // slli, srli, srai
+    REGISTER        // add, sub, sll, slt, sltu, xor, srl, sra, or, and
+};
+
+// Opcodes
+constexpr uint32_t OPCODE_LUI       = 0b0110111;
+constexpr uint32_t OPCODE_AUIPC     = 0b0010111;
+constexpr uint32_t OPCODE_JAL       = 0b1101111;
+constexpr uint32_t OPCODE_JALR      = 0b1100111;
+constexpr uint32_t OPCODE_BRANCH    = 0b1100011;
+constexpr uint32_t OPCODE_LOAD      = 0b0000011;
+constexpr uint32_t OPCODE_STORE     = 0b0100011;
+constexpr uint32_t OPCODE_IMMEDIATE = 0b0010011;
+constexpr uint32_t OPCODE_REGISTER  = 0b0110011;
+
+// Static description of one instruction. The immediate is drawn uniformly
+// from [imm_min, imm_max]; for shifts it is the shamt, for branches and jal the low
+// bit is cleared after drawing.
+struct InstrDesc {
+    const char* mnemonic;
+    Format format;
+    InstrClass instr_class;
+    uint8_t opcode;
+    uint8_t funct3;
+    uint8_t funct7;
+    int32_t imm_min;
+    int32_t imm_max;
+};
+
+constexpr InstrDesc instr_table[] = {
+
+    // mnemonic  format     class                    opcode            funct3  funct7     imm_min      imm_max
+    {"lui",     Format::U, InstrClass::UPPER,       OPCODE_LUI,       0b000, 0b0000000,  0,           0xFFFFF},
+    {"auipc",   Format::U, InstrClass::UPPER,       OPCODE_AUIPC,     0b000, 0b0000000,  0,           0xFFFFF},
+    {"jal",     Format::J, InstrClass::JUMP,        OPCODE_JAL,       0b000, 0b0000000,  -(1 << 20),  (1 << 20) - 1},
+    {"jalr",    Format::I, InstrClass::JUMP_REG,    OPCODE_JALR,      0b000, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"beq",     Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b000, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"bne",     Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b001, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"blt",     Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b100, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"bge",     Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b101, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"bltu",    Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b110, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"bgeu",    Format::B, InstrClass::BRANCH,      OPCODE_BRANCH,    0b111, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"lb",      Format::I, InstrClass::LOAD,        OPCODE_LOAD,      0b000, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"lh",      Format::I, InstrClass::LOAD,        OPCODE_LOAD,      0b001, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"lw",      Format::I, InstrClass::LOAD,        OPCODE_LOAD,      0b010, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"lbu",     Format::I, InstrClass::LOAD,        OPCODE_LOAD,      0b100, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"lhu",     Format::I, InstrClass::LOAD,        OPCODE_LOAD,      0b101, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"sb",      Format::S, InstrClass::STORE,       OPCODE_STORE,     0b000, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"sh",      Format::S, InstrClass::STORE,       OPCODE_STORE,     0b001, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"sw",      Format::S, InstrClass::STORE,       OPCODE_STORE,     0b010, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"addi",    Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b000, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"slti",    Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b010, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"sltiu",   Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b011, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"xori",    Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b100, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"ori",     Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b110, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"andi",    Format::I, InstrClass::IMMEDIATE,   OPCODE_IMMEDIATE, 0b111, 0b0000000,  -(1 << 11),  (1 << 11) - 1},
+    {"slli",    Format::I, InstrClass::SHIFT,       OPCODE_IMMEDIATE, 0b001, 0b0000000,  0,           31},
+    {"srli",    Format::I, InstrClass::SHIFT,       OPCODE_IMMEDIATE, 0b101, 0b0000000,  0,           31},
+    {"srai",    Format::I, InstrClass::SHIFT,       OPCODE_IMMEDIATE, 0b101, 0b0100000,  0,           31},
+    {"add",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b000, 0b0000000,  0,           0},
+    {"sub",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b000, 0b0100000,  0,           0},
+    {"sll",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b001, 0b0000000,  0,           0},
+    {"slt",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b010, 0b0000000,  0,           0},
+    {"sltu",    Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b011, 0b0000000,  0,           0},
+    {"xor",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b100, 0b0000000,  0,           0},
+    {"srl",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b101, 0b0000000,  0,           0},
+    {"sra",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b101, 0b0100000,  0,           0},
+    {"or",      Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b110, 0b0000000,  0,           0},
+    {"and",     Format::R, InstrClass::REGISTER,    OPCODE_REGISTER,  0b111, 0b0000000,  0,           0}
+
+};
+
+constexpr size_t INSTR_COUNT = sizeof(instr_table) / sizeof(instr_table[0]);
+
+static_assert(INSTR_COUNT == 37, "RV32I base set (minus fence/system) has 37 instructions");
+
+// Index of each instruction in instr_table
+enum InstrId : uint8_t {
+    ID_LUI, ID_AUIPC, ID_JAL, ID_JALR,
+    ID_BEQ, ID_BNE, ID_BLT, ID_BGE, ID_BLTU, ID_BGEU,
+    ID_LB, ID_LH, ID_LW, ID_LBU, ID_LHU,
+    ID_SB, ID_SH, ID_SW,
+    ID_ADDI, ID_SLTI, ID_SLTIU, ID_XORI, ID_ORI, ID_ANDI,
+    ID_SLLI, ID_SRLI, ID_SRAI,
+    ID_ADD, ID_SUB, ID_SLL, ID_SLT, ID_SLTU, ID_XOR, ID_SRL, ID_SRA, ID_OR, ID_AND
+};
+
+static_assert(ID_AND + 1 == INSTR_COUNT, "InstrId must cover instr_table");
+static_assert(instr_table[ID_JALR].opcode == OPCODE_JALR && instr_table[ID_SW].funct3 == 0b010 &&
+              instr_table[ID_SRAI].funct7 == 0b0100000 && instr_table[ID_AND].funct3 == 0b111,
+              "InstrId must follow instr_table order");
+
+// Compact instruction record: descriptor index, operand indices, immediate.
+// For shifts imm is the shamt; fields a format does not use are ignored.
+struct InstrRecord {
+    uint8_t id;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    int32_t imm;
+};
+
+static_assert(sizeof(InstrRecord) == 8, "InstrRecord must stay 8 bytes");
+
+#endif // INSTR_TABLE_H
@@ -0,0 +1,358 @@
+#include <cstring>
+
+#include "iss.h"
+#include "decoder.h"
+
+//-------------------------------------------------
+// Sparse Memory
+//-------------------------------------------------
+
+uint8_t* SparseMemory::lookup_page(uint32_t page_number) const {
+
+    const Leaf* leaf = root[page_number >> 10].get();
+    uint8_t* page = leaf ? leaf->pages[page_number & 0x3FF].get() : nullptr;
+
+    // Only cache real pages, so a later write to this page still allocates
+    if (page) {
+
+        cached_number = page_number;
+        cached_page = page;
+
+    }
+
+    return page;
+
+}
+
+
+
+uint8_t* SparseMemory::allocate_page(uint32_t page_number) {
+
+    if (uint8_t* page = lookup_page(page_number)) {
+
+        return page;
+
+    }
+
+    std::unique_ptr<Leaf>& leaf = root[page_number >> 10];
+
+    if (!leaf) {
+
+        leaf = std::make_unique<Leaf>();
+
+    }
+
+    std::unique_ptr<uint8_t[]>& page = leaf->pages[page_number & 0x3FF];
+    page.reset(new uint8_t[PAGE_SIZE]());
+    page_count++;
+
+    cached_number = page_number;
+    cached_page = page.get();
+    return cached_page;
+
+}
+
+
+
+uint32_t SparseMemory::read_split(uint32_t addr, uint32_t size) const {
+
+    uint32_t value = 0;
+
+    for (uint32_t i = 0; i < size; ++i) {
+
+        value |= read(addr + i, 1) << (8 * i);
+
+    }
+
+    return value;
+
+}
+
+
+
+void SparseMemory::write_split(uint32_t addr, uint32_t value, uint32_t size) {
+
+    for (uint32_t i = 0; i < size; ++i) {
+
+        write(addr + i, value >> (8 * i), 1);
+
+    }
+
+}
+
+
+
+void SparseMemory::load_words(uint32_t addr, const uint32_t* words, size_t n) {
+
+    for (size_t i = 0; i < n; ++i) {
+
+        write(addr + static_cast<uint32_t>(i) * 4, words[i], 4);
+
+    }
+
+}
+
+
+//-------------------------------------------------
+// Simulator
+//-------------------------------------------------
+
+// Pre-decoded id for words the decoder rejects
+constexpr uint8_t ISS_ILLEGAL = INSTR_COUNT;
+
+const char* stop_reason_name(StopReason reason) {
+
+    switch (reason) {
+
+        case StopReason::END_OF_PROGRAM:      return "end of program";
+        case StopReason::PC_OUT_OF_RANGE:     return "pc out of range";
+        case StopReason::MISALIGNED_PC:       return "misaligned pc";
+        case StopReason::ILLEGAL_INSTRUCTION: return "illegal instruction";
+        case StopReason::STEP_LIMIT:          return "step limit";
+        case StopReason::HALT:                return "halt";
+
+    }
+
+    return "unknown";
+
+}
+
+
+
+Iss::Iss(const uint32_t* program, size_t n, uint32_t base) : code(n), base(base) {
+
+    for (size_t i = 0; i < n; ++i) {
+
+        InstrRecord& rec = code[i];
+
+        if (!decode_instr(program[i], rec)) {
+
+            rec = {ISS_ILLEGAL, 0, 0, 0, 0};
+            continue;
+
+        }
+
+        // U-Type immediates are stored pre-shifted
+        if (instr_table[rec.id].format == Format::U) {
+
+            rec.imm = static_cast<int32_t>(static_cast<uint32_t>(rec.imm) << 12);
+
+        }
+
+    }
+
+    mem.load_words(base, program, n);
+
+}
+
+
+
+IssResult Iss::run(uint64_t max_steps, CommitLog* log) {
+
+    return log ? run_impl<true>(max_steps, log) : run_impl<false>(max_steps, log);
+
+}
+
+
+
+template <bool LOG>
+IssResult Iss::run_impl(uint64_t max_steps, CommitLog* log) {
+
+    const InstrRecord* const text = code.data();
+    const size_t size = code.size();
+    size_t idx = pc_index;
+    uint64_t retired = 0;
+    uint32_t stop_pc = 0;
+    StopReason reason = StopReason::END_OF_PROGRAM;
+    const InstrRecord* r = nullptr;
+
+// pc of the executing instruction
+#define PC (base + static_cast<uint32_t>(idx) * 4)
+
+#define COMMIT(rd, value) \
+    do { if (LOG) log->append(PC, static_cast<uint8_t>(rd), (value)); } while (0)
+
+// Write rd and log it; x0 is cleared again instead of branching on rd
+#define WRITE_RD(value)                                             \
+    do {                                                            \
+        x[r->rd] = (value);                                         \
+        x[0] = 0;                                                   \
+        COMMIT(r->rd, x[r->rd]);                                    \
+    } while (0)
+
+// Fetch the next instruction, stopping at the end or the step limit
+#define FETCH()                                                     \
+    do {                                                            \
+        if (idx >= size) { goto stop_at_end; }                      \
+        if (retired >= max_steps) { goto stop_at_limit; }           \
+        r = &text[idx];                                             \
+        ++retired;                                                  \
+    } while (0)
+
+#define NEXT() do { ++idx; DISPATCH(); } while (0)
+
+// Continue at an absolute target address
+#define JUMP_TO(target)                                             \
+    do {                                                            \
+        uint32_t t_ = (target);                                     \
+        uint32_t off_ = t_ - base;                                  \
+        if (off_ & 0x3) {                                           \
+            stop_pc = t_; reason = StopReason::MISALIGNED_PC;       \
+            goto stop_at_target;                                    \
+        }                                                           \
+        if (off_ / 4 > size) {                                      \
+            stop_pc = t_; reason = StopReason::PC_OUT_OF_RANGE;     \
+            goto stop_at_target;                                    \
+        }                                                           \
+        idx = off_ / 4;                                             \
+        DISPATCH();                                                 \
+    } while (0)
+
+#define BRANCH_IF(cond)                                             \
+    do {                                                            \
+        COMMIT(0, 0);                                               \
+        if (cond) { JUMP_TO(PC + static_cast<uint32_t>(r->imm)); }  \
+        NEXT();                                                     \
+    } while (0)
+
+#define LOAD(size, sign_bits)                                                       \
+    do {                                                                            \
+        uint32_t m_ = mem.read(x[r->rs1] + static_cast<uint32_t>(r->imm), size);    \
+        WRITE_RD((sign_bits) ? static_cast<uint32_t>(sign_extend(m_, sign_bits)) : m_); \
+        NEXT();                                                                     \
+    } while (0)
+
+#define STORE(size)                                                                 \
+    do {                                                                            \
+        mem.write(x[r->rs1] + static_cast<uint32_t>(r->imm), x[r->rs2], size);      \
+        COMMIT(0, 0);                                                               \
+        NEXT();                                                                     \
+    } while (0)
+
+#define RS1 x[r->rs1]
+#define RS2 x[r->rs2]
+#define IMM static_cast<uint32_t>(r->imm)
+
+#if defined(__GNUC__)
+
+    // Threaded dispatch: every handler ends in its own indirect jump
+    static void* const handlers[INSTR_COUNT + 1] = {
+        &&op_LUI, &&op_AUIPC, &&op_JAL, &&op_JALR,
+        &&op_BEQ, &&op_BNE, &&op_BLT, &&op_BGE, &&op_BLTU, &&op_BGEU,
+        &&op_LB, &&op_LH, &&op_LW, &&op_LBU, &&op_LHU,
+        &&op_SB, &&op_SH, &&op_SW,
+        &&op_ADDI, &&op_SLTI, &&op_SLTIU, &&op_XORI, &&op_ORI, &&op_ANDI,
+        &&op_SLLI, &&op_SRLI, &&op_SRAI,
+        &&op_ADD, &&op_SUB, &&op_SLL, &&op_SLT, &&op_SLTU, &&op_XOR, &&op_SRL, &&op_SRA, &&op_OR, &&op_AND,
+        &&op_ILLEGAL
+    };
+
+#define DISPATCH() do { FETCH(); goto *handlers[r->id]; } while (0)
+#define OP(name) op_##name:
+
+    DISPATCH();
+
+#else
+
+#define DISPATCH() goto dispatch
+#define OP(name) case ID_##name:
+#define ID_ILLEGAL ISS_ILLEGAL
+
+dispatch:
+    FETCH();
+
+    switch (r->id) {
+
+#endif
+
+    OP(LUI)     WRITE_RD(IMM); NEXT();
+    OP(AUIPC)   WRITE_RD(PC + IMM); NEXT();
+    OP(JAL)     { uint32_t t = PC + IMM; WRITE_RD(PC + 4); if (IMM == 0) { goto stop_at_halt; } JUMP_TO(t); }
+    OP(JALR)    { uint32_t t = (RS1 + IMM) & ~1u; WRITE_RD(PC + 4); JUMP_TO(t); }
+
+    OP(BEQ)     BRANCH_IF(RS1 == RS2);
+    OP(BNE)     BRANCH_IF(RS1 != RS2);
+    OP(BLT)     BRANCH_IF(static_cast<int32_t>(RS1) < static_cast<int32_t>(RS2));
+    OP(BGE)     BRANCH_IF(static_cast<int32_t>(RS1) >= static_cast<int32_t>(RS2));
+    OP(BLTU)    BRANCH_IF(RS1 < RS2);
+    OP(BGEU)    BRANCH_IF(RS1 >= RS2);
+
+    OP(LB)      LOAD(1, 8);
+    OP(LH)      LOAD(2, 16);
+    OP(LW)      LOAD(4, 0);
+    OP(LBU)     LOAD(1, 0);
+    OP(LHU)     LOAD(2, 0);
+
+    OP(SB)      STORE(1);
+    OP(SH)      STORE(2);
+    OP(SW)      STORE(4);
+
+    OP(ADDI)    WRITE_RD(RS1 + IMM); NEXT();
+    OP(SLTI)    WRITE_RD(static_cast<int32_t>(RS1) < r->imm); NEXT();
+    OP(SLTIU)   WRITE_RD(RS1 < IMM); NEXT();
+    OP(XORI)    WRITE_RD(RS1 ^ IMM); NEXT();
+    OP(ORI)     WRITE_RD(RS1 | IMM); NEXT();
+    OP(ANDI)    WRITE_RD(RS1 & IMM); NEXT();
+
+    OP(SLLI)    WRITE_RD(RS1 << IMM); NEXT();
+    OP(SRLI)    WRITE_RD(RS1 >> IMM); NEXT();
+    OP(SRAI)    WRITE_RD(static_cast<uint32_t>(static_cast<int32_t>(RS1) >> IMM)); NEXT();
+
+    OP(ADD)     WRITE_RD(RS1 + RS2); NEXT();
+    OP(SUB)     WRITE_RD(RS1 - RS2); NEXT();
+    OP(SLL)     WRITE_RD(RS1 << (RS2 & 0x1F)); NEXT();
+    OP(SLT)     WRITE_RD(static_cast<int32_t>(RS1) < static_cast<int32_t>(RS2)); NEXT();
+    OP(SLTU)    WRITE_RD(RS1 < RS2); NEXT();
+    OP(XOR)     WRITE_RD(RS1 ^ RS2); NEXT();
+    OP(SRL)     WRITE_RD(RS1 >> (RS2 & 0x1F)); NEXT();
+    OP(SRA)     WRITE_RD(static_cast<uint32_t>(static_cast<int32_t>(RS1) >> (RS2 & 0x1F))); NEXT();
+    OP(OR)      WRITE_RD(RS1 | RS2); NEXT();
+    OP(AND)     WRITE_RD(RS1 & RS2); NEXT();
+
+    OP(ILLEGAL) {
+        --retired;
+        reason = StopReason::ILLEGAL_INSTRUCTION;
+        pc_index = idx;
+        return {reason, retired, PC};
+    }
+
+#if !defined(__GNUC__)
+    default: break;
+
+    }
+#endif
+
+stop_at_end:
+    pc_index = idx;
+    return {StopReason::END_OF_PROGRAM, retired, PC};
+
+stop_at_limit:
+    pc_index = idx;
+    return {StopReason::STEP_LIMIT, retired, PC};
+
+stop_at_halt:
+    // A jump to itself can never do anything else; it retired once
+    pc_index = idx;
+    return {StopReason::HALT, retired, PC};
+
+stop_at_target:
+    // The jump itself retired; execution cannot continue from here
+    pc_index = size;
+    return {reason, retired, stop_pc};
+
+#undef PC
+#undef COMMIT
+#undef WRITE_RD
+#undef FETCH
+#undef NEXT
+#undef JUMP_TO
+#undef BRANCH_IF
+#undef LOAD
+#undef STORE
+#undef RS1
+#undef RS2
+#undef IMM
+#undef DISPATCH
+#undef OP
+
+}
@@ -0,0 +1,197 @@
+#ifndef ISS_H
+#define ISS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "instr_table.h"
+#include "output.h"
+
+//-------------------------------------------------
+// RV32I Instruction-Set Simulator
+//
+// Golden model for generated streams. The program is pre-decoded once into
+// InstrRecords with the decoder table, then executed with threaded dispatch
+// (computed goto on GCC/Clang, a switch elsewhere). Data memory is sparse:
+// 4 KiB pages are allocated on first write and untouched memory reads as
+// zero. Stores into the program image update memory but not the pre-decoded
+// instructions (no self-modifying code).
+//-------------------------------------------------
+
+class SparseMemory {
+
+public:
+
+    static constexpr uint32_t PAGE_BITS = 12;
+    static constexpr uint32_t PAGE_SIZE = uint32_t{1} << PAGE_BITS;
+
+    // Little-endian access of 1, 2 or 4 bytes; may be misaligned. Inline so
+    // the byte loops fold into one access when size is a constant.
+    uint32_t read(uint32_t addr, uint32_t size) const {
+
+        uint32_t offset = addr & (PAGE_SIZE - 1);
+        uint32_t value = 0;
+
+        if (offset + size > PAGE_SIZE) {
+
+            return read_split(addr, size);
+
+        }
+
+        if (const uint8_t* page = find_page(addr >> PAGE_BITS)) {
+
+            for (uint32_t i = 0; i < size; ++i) {
+
+                value |= static_cast<uint32_t>(page[offset + i]) << (8 * i);
+
+            }
+
+        }
+
+        return value;
+
+    }
+
+    void write(uint32_t addr, uint32_t value, uint32_t size) {
+
+        uint32_t offset = addr & (PAGE_SIZE - 1);
+
+        if (offset + size > PAGE_SIZE) {
+
+            write_split(addr, value, size);
+            return;
+
+        }
+
+        uint8_t* page = touch_page(addr >> PAGE_BITS);
+
+        for (uint32_t i = 0; i < size; ++i) {
+
+            page[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+
+        }
+
+    }
+
+    void load_words(uint32_t addr, const uint32_t* words, size_t n);
+
+    size_t pages_allocated() const { return page_count; }
+
+private:
+
+    // Two-level page table: addr[31:22] selects a leaf, addr[21:12] a page
+    struct Leaf {
+        std::unique_ptr<uint8_t[]> pages[1024];
+    };
+
+    uint8_t* find_page(uint32_t page_number) const {
+
+        return page_number == cached_number ? cached_page : lookup_page(page_number);
+
+    }
+
+    uint8_t* touch_page(uint32_t page_number) {
+
+        return page_number == cached_number ? cached_page : allocate_page(page_number);
+
+    }
+
+    uint8_t* lookup_page(uint32_t page_number) const;
+    uint8_t* allocate_page(uint32_t page_number);
+
+    // Accesses that straddle a page boundary, one byte at a time
+    uint32_t read_split(uint32_t addr, uint32_t size) const;
+    void write_split(uint32_t addr, uint32_t value, uint32_t size);
+
+    std::unique_ptr<Leaf> root[1024];
+    size_t page_count = 0;
+
+    // Last page looked up, since consecutive accesses usually share a page
+    mutable uint32_t cached_number = ~0u;
+    mutable uint8_t* cached_page = nullptr;
+
+};
+
+// Binary commit log: one 9-byte little-endian record per retired
+// instruction, { uint32 pc; uint8 rd; uint32 value; }. Instructions that do
+// not write a register (stores, branches, rd = x0) log rd = 0, value = 0.
+class CommitLog {
+
+public:
+
+    static constexpr size_t RECORD_SIZE = 9;
+
+    explicit CommitLog(const char* path) : file(path) {}
+
+    void append(uint32_t pc, uint8_t rd, uint32_t value) {
+
+        unsigned char* p = reinterpret_cast<unsigned char*>(file.reserve(RECORD_SIZE));
+        p[0] = static_cast<unsigned char>(pc);
+        p[1] = static_cast<unsigned char>(pc >> 8);
+        p[2] = static_cast<unsigned char>(pc >> 16);
+        p[3] = static_cast<unsigned char>(pc >> 24);
+        p[4] = rd;
+        p[5] = static_cast<unsigned char>(value);
+        p[6] = static_cast<unsigned char>(value >> 8);
+        p[7] = static_cast<unsigned char>(value >> 16);
+        p[8] = static_cast<unsigned char>(value >> 24);
+
+    }
+
+    void flush() { file.flush(); }
+
+private:
+
+    BlockFile file;
+
+};
+
+enum class StopReason : uint8_t {
+    END_OF_PROGRAM,         // fell through the last instruction
+    PC_OUT_OF_RANGE,        // jump or branch left the program
+    MISALIGNED_PC,          // jump or branch target not 4-byte aligned
+    ILLEGAL_INSTRUCTION,    // word is not an RV32I table instruction
+    STEP_LIMIT,             // max_steps instructions retired
+    HALT                    // reached a "jal x0, 0"-style jump to itself
+};
+
+const char* stop_reason_name(StopReason reason);
+
+struct IssResult {
+    StopReason reason;
+    uint64_t retired;
+    uint32_t pc;            // pc of the next instruction (or the bad target)
+};
+
+class Iss {
+
+public:
+
+    // Load program at base (mapped into memory too) with pc = base and all
+    // registers zero
+    Iss(const uint32_t* program, size_t n, uint32_t base = ELF_TEXT_BASE);
+
+    // Execute until a stop condition; may be called again to continue
+    IssResult run(uint64_t max_steps, CommitLog* log = nullptr);
+
+    uint32_t reg(uint32_t index) const { return x[index]; }
+    void set_reg(uint32_t index, uint32_t value) { if (index != 0) x[index] = value; }
+    uint32_t pc() const { return base + static_cast<uint32_t>(pc_index) * 4; }
+    SparseMemory& memory() { return mem; }
+
+private:
+
+    template <bool LOG>
+    IssResult run_impl(uint64_t max_steps, CommitLog* log);
+
+    std::vector<InstrRecord> code;
+    uint32_t base;
+    uint32_t x[32] = {};
+    size_t pc_index = 0;
+    SparseMemory mem;
+
+};
+
+#endif // ISS_H
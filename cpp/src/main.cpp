@@ -1,824 +1,1145 @@
 #include <iostream>
 #include <string>
-#include <unordered_map>
-#include <functional>
-#include <utility>
 #include <cstdint>
-#include <ctime>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include <pthread.h>
+#include <signal.h>
+
+#include "instr_table.h"
+#include "encoders.h"
+#include "generator.h"
+#include "shard.h"
+#include "batch_encode.h"
+#include "output.h"
+#include "mix.h"
+#include "iss.h"
+#include "decoder.h"
+#include "roundtrip.h"
+#include "coverage.h"
+#include "stats.h"
+#include "program.h"
+#include "mapped_output.h"
+#include "checkpoint.h"
+#include "unique.h"
+#include "pipeline.h"
+#include "serve.h"
+#include "corpus.h"
 
 //-------------------------------------------------
 // Function Prototypes
 //-------------------------------------------------
-void initialize_register_map();
-std::string select_random_register();
-std::pair<std::string, uint32_t> gen_rand_instr();
-std::pair<std::string, uint32_t> gen_rand_LUI();
-std::pair<std::string, uint32_t> gen_rand_AUIPC();
-std::pair<std::string, uint32_t> gen_rand_JAL();
-std::pair<std::string, uint32_t> gen_rand_JALR();
-std::pair<std::string, uint32_t> gen_rand_branch(const std::string& instr_name, uint32_t funct3);
-std::pair<std::string, uint32_t> gen_rand_BEQ();
-std::pair<std::string, uint32_t> gen_rand_BNE();
-std::pair<std::string, uint32_t> gen_rand_BLT();
-std::pair<std::string, uint32_t> gen_rand_BGE();
-std::pair<std::string, uint32_t> gen_rand_BLTU();
-std::pair<std::string, uint32_t> gen_rand_BGEU();
-std::pair<std::string, uint32_t> gen_rand_load(const std::string& instr_name, uint32_t funct3);
-std::pair<std::string, uint32_t> gen_rand_LB();
-std::pair<std::string, uint32_t> gen_rand_LH();
-std::pair<std::string, uint32_t> gen_rand_LW();
-std::pair<std::string, uint32_t> gen_rand_LBU();
-std::pair<std::string, uint32_t> gen_rand_LHU();
-std::pair<std::string, uint32_t> gen_rand_store(const std::string& instr_name, uint32_t funct3);
-std::pair<std::string, uint32_t> gen_rand_SB();
-std::pair<std::string, uint32_t> gen_rand_SH();
-std::pair<std::string, uint32_t> gen_rand_SW();
-std::pair<std::string, uint32_t> gen_rand_immediate(const std::string& instr_name, uint32_t funct3);
-std::pair<std::string, uint32_t> gen_rand_ADDI();
-std::pair<std::string, uint32_t> gen_rand_SLTI();
-std::pair<std::string, uint32_t> gen_rand_SLTIU();
-std::pair<std::string, uint32_t> gen_rand_XORI();
-std::pair<std::string, uint32_t> gen_rand_ORI();
-std::pair<std::string, uint32_t> gen_rand_ANDI();
-std::pair<std::string, uint32_t> gen_rand_shift(const std::string& instr_name, uint32_t funct3, uint32_t funct7);
-std::pair<std::string, uint32_t> gen_rand_SLLI();
-std::pair<std::string, uint32_t> gen_rand_SRLI();
-std::pair<std::string, uint32_t> gen_rand_SRAI();
-std::pair<std::string, uint32_t> gen_rand_register(const std::string& instr_name, uint32_t funct3, uint32_t funct7);
-std::pair<std::string, uint32_t> gen_rand_ADD();
-std::pair<std::string, uint32_t> gen_rand_SUB();
-std::pair<std::string, uint32_t> gen_rand_SLL();
-std::pair<std::string, uint32_t> gen_rand_SLT();
-std::pair<std::string, uint32_t> gen_rand_SLTU();
-std::pair<std::string, uint32_t> gen_rand_XOR();
-std::pair<std::string, uint32_t> gen_rand_SRL();
-std::pair<std::string, uint32_t> gen_rand_SRA();
-std::pair<std::string, uint32_t> gen_rand_OR();
-std::pair<std::string, uint32_t> gen_rand_AND();
-uint32_t encode_R_type(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode);
-uint32_t encode_I_type(uint32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode);
-uint32_t encode_S_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode);
-uint32_t encode_B_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode);
-uint32_t encode_U_type(uint32_t imm, uint32_t rd, uint32_t opcode);
-uint32_t encode_J_type(uint32_t imm, uint32_t rd, uint32_t opcode);
+bool parse_rng_kind(const char* name, RngKind& kind);
+bool parse_reg_list(const char* list, uint32_t& mask);
+bool verify_disassembly(const GenConfig& config, size_t n, std::ostream& log);
+bool finish_coverage(const CoverageMap& coverage, const GenConfig& config, const char* out_path, bool report);
+bool write_checkpoint(const char* path, const GenConfig& config, uint64_t position, const CoverageMap* coverage);
 
 
 //-------------------------------------------------
-// Define a map to associate instructions with their respective functions
+// Main Function
 //-------------------------------------------------
 
-std::unordered_map<std::string, uint32_t> register_map;
-
-std::unordered_map<std::string, std::function<std::pair<std::string, uint32_t>()>> instr_functions = {
-
-        {"LUI", gen_rand_LUI},
-        {"AUIPC", gen_rand_AUIPC},
-        {"JAL", gen_rand_JAL},
-        {"JALR", gen_rand_JALR},
-        {"BEQ", gen_rand_BEQ},
-        {"BNE", gen_rand_BNE},
-        {"BLT", gen_rand_BLT},
-        {"BGE", gen_rand_BGE},
-        {"BLTU", gen_rand_BLTU},
-        {"BGEU", gen_rand_BGEU},
-        {"LB", gen_rand_LB},
-        {"LH", gen_rand_LH},
-        {"LW", gen_rand_LW},
-        {"LBU", gen_rand_LBU},
-        {"LHU", gen_rand_LHU},
-        {"SB", gen_rand_SB},
-        {"SH", gen_rand_SH},
-        {"SW", gen_rand_SW},
-        {"ADDI", gen_rand_ADDI},
-        {"SLTI", gen_rand_SLTI},
-        {"SLTIU", gen_rand_SLTIU},
-        {"XORI", gen_rand_XORI},
-        {"ORI", gen_rand_ORI},
-        {"ANDI", gen_rand_ANDI},
-        {"SLLI", gen_rand_SLLI},
-        {"SRLI", gen_rand_SRLI},
-        {"SRAI", gen_rand_SRAI},
-        {"ADD", gen_rand_ADD},
-        {"SUB", gen_rand_SUB},
-        {"SLL", gen_rand_SLL},
-        {"SLT", gen_rand_SLT},
-        {"SLTU", gen_rand_SLTU},
-        {"XOR", gen_rand_XOR},
-        {"SRL", gen_rand_SRL},
-        {"SRA", gen_rand_SRA},
-        {"OR", gen_rand_OR},
-        {"AND", gen_rand_AND}
-
-    };
+int main(int argc, char* argv[]) {
 
+    // Parse command line options
+    size_t count = 25;
+    bool count_given = false;
+    bool text_output = true;
+    bool format_given = false;
+    bool encodings_only = false;
+    OutputFormat format = OutputFormat::READMEMH;
+    const char* output_path = nullptr;
+    bool seed_given = false;
+    unsigned threads = 1;
+    bool mix_report = false;
+    bool self_test = false;
+    bool fuzz = false;
+    bool sweep = false;
+    bool simulate = false;
+    bool program_mode = false;
+    size_t jump_reach = DEFAULT_JUMP_REACH;
+    uint64_t max_steps = UINT64_MAX;
+    const char* commit_log_path = nullptr;
+    double coverage_target = 0;
+    std::vector<const char*> coverage_inputs;
+    const char* coverage_output = nullptr;
+    bool coverage_report = false;
+    const char* stats_path = nullptr;
+    uint64_t start_index = 0;
+    bool start_given = false;
+    const char* checkpoint_path = nullptr;
+    const char* resume_path = nullptr;
+    uint64_t unique_per_instr = 0;
+    bool dedup = false;
+    bool hazard_report = false;
+    bool mmap_output = false;
+    MappedOutputOptions mmap_options;
+    PipelineOptions pipeline_options;
+    const char* serve_path = nullptr;
+    std::vector<const char*> serve_mixes;
+    const char* corpus_path = nullptr;
+    GenConfig config;
 
-//-------------------------------------------------
-// Main Function
-//-------------------------------------------------
+    for (int i = 1; i < argc; ++i) {
 
-int main(int argc, char* argv[]) {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
 
-    // Seed the random number generator
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
+            count = std::strtoull(argv[++i], nullptr, 0);
+            count_given = true;
 
-    // Initialize the register map
-    initialize_register_map();
+        } else if (std::strcmp(argv[i], "--encodings-only") == 0) {
 
-    for(int i = 0; i < 25; i++) {
+            encodings_only = true;
 
-        // Generate and output a random instruction
-        std::pair<std::string, uint32_t> instr = gen_rand_instr();
-        std::cout << instr.first << "\n" << std::hex << instr.second << "\n\n";
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
 
-    }
+            format_given = true;
+            text_output = std::strcmp(argv[++i], "text") == 0;
 
-    return 0;
+            if (!text_output && !parse_output_format(argv[i], format)) {
 
-}
+                std::cerr << "unknown format: " << argv[i] << "\n";
+                return 1;
 
+            }
 
-//-------------------------------------------------
-// Function Definitions
-//-------------------------------------------------
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
 
-void initialize_register_map() {
+            output_path = argv[++i];
 
-    for (uint32_t i = 0; i < 32; ++i) {
+        } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
 
-        register_map["x" + std::to_string(i)] = i;
+            config.seed = std::strtoull(argv[++i], nullptr, 0);
+            seed_given = true;
 
-    }
+        } else if (std::strcmp(argv[i], "--rng") == 0 && i + 1 < argc && parse_rng_kind(argv[i + 1], config.rng)) {
 
-}
+            ++i;
+
+        } else if (std::strcmp(argv[i], "--self-test") == 0) {
+
+            self_test = true;
+
+        } else if (std::strcmp(argv[i], "--fuzz") == 0) {
+
+            fuzz = true;
+
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+
+            sweep = true;
+
+        } else if (std::strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+
+            try {
+
+                load_mix_file(argv[++i], config.weights);
+
+            } catch (const std::exception& e) {
+
+                std::cerr << "error: " << e.what() << "\n";
+                return 1;
+
+            }
+
+        } else if (std::strcmp(argv[i], "--mix-report") == 0) {
+
+            mix_report = true;
+
+        } else if (std::strcmp(argv[i], "--no-x0-rd") == 0) {
+
+            config.regs.no_x0_rd = true;
+
+        } else if (std::strcmp(argv[i], "--rd-ne-rs1") == 0) {
+
+            config.regs.rd_ne_rs1 = true;
+
+        } else if (std::strcmp(argv[i], "--base-regs") == 0 && i + 1 < argc && parse_reg_list(argv[i + 1], config.regs.base_regs)) {
+
+            ++i;
+
+        } else if (std::strcmp(argv[i], "--hot-regs") == 0 && i + 1 < argc && parse_reg_list(argv[i + 1], config.regs.hot_regs)) {
+
+            ++i;
+
+        } else if (std::strcmp(argv[i], "--hot-percent") == 0 && i + 1 < argc) {
+
+            config.regs.hot_percent = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+
+        } else if (std::strcmp(argv[i], "--raw-distance") == 0 && i + 1 < argc && parse_raw_distances(argv[i + 1], config.hazards)) {
+
+            ++i;
+
+        } else if (std::strcmp(argv[i], "--load-use") == 0 && i + 1 < argc) {
+
+            config.hazards.load_use_percent = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+
+        } else if (std::strcmp(argv[i], "--waw") == 0 && i + 1 < argc) {
+
+            config.hazards.waw_percent = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 0));
+
+        } else if (std::strcmp(argv[i], "--hazard-report") == 0) {
+
+            hazard_report = true;
+
+        } else if (std::strcmp(argv[i], "--simulate") == 0) {
+
+            simulate = true;
+
+        } else if (std::strcmp(argv[i], "--program") == 0) {
+
+            program_mode = true;
+
+        } else if (std::strcmp(argv[i], "--jump-reach") == 0 && i + 1 < argc) {
+
+            jump_reach = std::strtoull(argv[++i], nullptr, 0);
+
+        } else if (std::strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+
+            max_steps = std::strtoull(argv[++i], nullptr, 0);
+
+        } else if (std::strcmp(argv[i], "--commit-log") == 0 && i + 1 < argc) {
+
+            commit_log_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--coverage-target") == 0 && i + 1 < argc) {
+
+            coverage_target = std::strtod(argv[++i], nullptr) / 100.0;
+
+        } else if (std::strcmp(argv[i], "--coverage-in") == 0 && i + 1 < argc) {
+
+            coverage_inputs.push_back(argv[++i]);
+
+        } else if (std::strcmp(argv[i], "--coverage-out") == 0 && i + 1 < argc) {
 
-std::string select_random_register() {
+            coverage_output = argv[++i];
 
-    // Randomly select an index in the range [0, 31]
-    int random_index = std::rand() % 32;
+        } else if (std::strcmp(argv[i], "--coverage-report") == 0) {
 
-    // Iterate through the register_map to get the nth key
-    int count = 0;
+            coverage_report = true;
 
-    std::string selected_register;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
 
-    for (std::pair<std::string, uint32_t> entry : register_map) {
+            threads = resolve_threads(static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 0)));
 
-        if (count == random_index) {
+        } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
 
-            selected_register = entry.first;
-            break;
+            stats_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--start") == 0 && i + 1 < argc) {
+
+            start_index = std::strtoull(argv[++i], nullptr, 0);
+            start_given = true;
+
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+
+            checkpoint_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+
+            resume_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--unique") == 0 && i + 1 < argc) {
+
+            unique_per_instr = std::strtoull(argv[++i], nullptr, 0);
+
+        } else if (std::strcmp(argv[i], "--dedup") == 0) {
+
+            dedup = true;
+
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+
+            serve_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--serve-mix") == 0 && i + 1 < argc) {
+
+            serve_mixes.push_back(argv[++i]);
+
+        } else if (std::strcmp(argv[i], "--read-corpus") == 0 && i + 1 < argc) {
+
+            corpus_path = argv[++i];
+
+        } else if (std::strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+
+            pipeline_options.depth = std::max<size_t>(2, std::strtoull(argv[++i], nullptr, 0));
+
+        } else if (std::strcmp(argv[i], "--mmap") == 0) {
+
+            mmap_output = true;
+
+        } else if (std::strcmp(argv[i], "--mmap-window") == 0 && i + 1 < argc) {
+
+            mmap_options.window_bytes = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 0)) << 20;
+
+        } else if (std::strcmp(argv[i], "--mmap-populate") == 0) {
+
+            mmap_options.populate = true;
+
+        } else if (std::strcmp(argv[i], "--mmap-huge-pages") == 0) {
+
+            mmap_options.huge_pages = true;
+
+        } else {
+
+            std::cerr << "usage: " << argv[0] << " [--count N] [--seed S] [--rng xoshiro|philox] [--threads N]\n"
+                      << "       [--format text|bin|hex|memb|elf|corpus] [--output PATH] [--encodings-only]\n"
+                      << "       [--mix FILE] [--mix-report] [--self-test] [--fuzz] [--sweep]\n"
+                      << "       [--program [--jump-reach N]] [--simulate [--max-steps N] [--commit-log PATH]]\n"
+                      << "       [--coverage-target PERCENT] [--coverage-in FILE].. [--coverage-out FILE] [--coverage-report]\n"
+                      << "       [--no-x0-rd] [--rd-ne-rs1] [--base-regs xA,xB,..] [--hot-regs xA,xB,.. --hot-percent P]\n"
+                      << "       [--raw-distance D:P,..] [--load-use P] [--waw P] [--hazard-report]\n"
+                      << "       [--start K] [--checkpoint FILE] [--resume FILE] [--unique N] [--dedup]\n"
+                      << "       [--mmap [--mmap-window MIB] [--mmap-populate] [--mmap-huge-pages]] [--queue-depth N]\n"
+                      << "       [--serve SOCKET [--serve-mix FILE]..] [--read-corpus FILE] [--stats PATH]\n";
+            return 1;
+
+        }
+
+    }
+
+    // --encodings-only is shorthand for --format hex
+    if (encodings_only) {
+
+        if (format_given) {
+
+            std::cerr << "error: --encodings-only cannot be combined with --format\n";
+            return 1;
 
         }
 
-        count++;
+        text_output = false;
+        format = OutputFormat::READMEMH;
 
     }
 
-    return selected_register;
+    // Builds with GEN_STATS dump hot-path statistics at exit and on SIGUSR1
+    if (stats_enabled()) {
 
-}
+        stats_install(stats_path);
 
+    } else if (stats_path) {
 
+        std::cerr << "warning: --stats needs a build with GEN_STATS enabled\n";
 
-std::pair<std::string, uint32_t> gen_rand_instr() {
+    }
 
-    // Randomly select an instruction name from the instruction map keys
-    auto it = instr_functions.begin();
-    std::advance(it, std::rand() % instr_functions.size());
-    std::string instr_name = it->first;
+    if (self_test) {
 
-    // Call the corresponding instruction generation function
-    return instr_functions[instr_name]();
+        // Batch encoders against the scalar encoders, the scalar encoders
+        // against the decoder, the assembly text against the disassembler,
+        // the unique stream against the dedup filter, the server's replies
+        // against the stream and the stream read back from a corpus
+        GenConfig test_config;
+        test_config.seed = 1;
 
-}
+        bool ok = verify_batch_encoders(100003, 1, std::cout);
+        ok = fuzz_round_trip(test_config, 1000000, threads, std::cout).mismatches == 0 && ok;
+        ok = verify_disassembly(test_config, 100000, std::cout) && ok;
+        ok = verify_unique_stream(test_config, 32768, std::cout) && ok;
+        ok = verify_server(test_config, std::cout) && ok;
+        ok = verify_corpus(test_config, std::cout) && ok;
+        return ok ? 0 : 1;
 
+    }
 
+    if (sweep) {
 
-std::pair<std::string, uint32_t> gen_rand_LUI() {
+        // Exhaustive check of the whole legal encoding space
+        return sweep_round_trip(threads, std::cout).mismatches == 0 ? 0 : 1;
 
-    // Randomly select an rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+    }
 
-    // Generate a random 20-bit integer for the immediate field
-    uint32_t imm = std::rand() & 0xFFFFF;
+    if (corpus_path) {
 
-    // Set the opcode for the LUI instruction
-    uint32_t opcode = 0b0110111;
+        // Write out a stored corpus, or the window --start/--count of its
+        // stream, in any output format
+        try {
 
-    // Encode the instruction using the U-Type encoder
-    uint32_t instruction = encode_U_type(imm, rd_index, opcode);
+            Corpus corpus(corpus_path);
+            uint64_t end = corpus.start() + corpus.size();
+            uint64_t first = start_given ? start_index : corpus.start();
 
-    // Create the assembly instruction string
-    std::string asm_str = "lui " + rd + ", " + std::to_string(imm);
+            if (first < corpus.start() || first > end || (count_given && count > end - first)) {
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
-    
-}
+                std::cerr << "error: the corpus holds instructions [" << corpus.start() << ", " << end << ")\n";
+                return 1;
 
+            }
 
+            uint64_t limit = count_given ? count : end - first;
+            std::unique_ptr<OutputWriter> writer;
+            std::unique_ptr<AsmWriter> asm_writer;
 
-std::pair<std::string, uint32_t> gen_rand_AUIPC(){
+            if (text_output) {
 
-    // Randomly select an rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+                asm_writer = std::make_unique<AsmWriter>(output_path);
 
-    // Generate a random 20-bit integer for the immediate field
-    uint32_t imm = std::rand() & 0xFFFFF;
+            } else {
 
-    // Set the opcode for the AUIPC instruction
-    uint32_t opcode = 0b0010111;
+                writer = open_output(format, output_path, corpus.has_config() ? &corpus.config() : nullptr, first);
 
-    // Encode the instruction using the U-Type encoder
-    uint32_t instruction = encode_U_type(imm, rd_index, opcode);
+            }
 
-    // Create the assembly instruction string
-    std::string asm_str = "auipc " + rd + ", " + std::to_string(imm);
+            // Several blocks at a time, decoded in parallel
+            std::vector<InstrRecord> records(size_t{16} * corpus.block_size());
+            std::vector<uint32_t> words(records.size());
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+            for (uint64_t done = 0; done < limit; ) {
 
-}
+                size_t n = static_cast<size_t>(std::min<uint64_t>(records.size(), limit - done));
+                corpus.decode(first - corpus.start() + done, n, records.data(), threads);
 
+                if (asm_writer) {
 
+                    asm_writer->write(records.data(), n);
 
-std::pair<std::string, uint32_t> gen_rand_JAL(){
+                } else {
 
-    // Randomly select an rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+                    for (size_t i = 0; i < n; ++i) {
 
-    // Generate a random 21-bit signed immediate value
-    int32_t offset = (std::rand() % (1 << 21)) - (1 << 20);
+                        words[i] = encode_record(records[i]);
 
-    // Set the opcode for the JAL instruction
-    uint32_t opcode = 0b1101111;
+                    }
 
-    // Encode the instruction using the J-Type encoder
-    uint32_t instruction = encode_J_type(static_cast<uint32_t>(offset), rd_index, opcode);
+                    writer->write(words.data(), n);
 
-    // Create the assembly instruction string
-    std::string asm_str = "jal " + rd + ", " + std::to_string(offset);
+                }
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+                done += n;
 
-}
+            }
 
+            if (asm_writer) {
 
+                asm_writer->finish();
 
-std::pair<std::string, uint32_t> gen_rand_JALR() {
+            } else {
 
-    // Randomly select an rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+                writer->finish();
 
-    // Randomly select an rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+            }
 
-    // Generate a random signed 11-bit offset
-    int32_t offset = (std::rand() % (1 << 12)) - (1 << 11);
+        } catch (const std::exception& e) {
 
-    // Set the opcode for the JALR instruction
-    uint32_t opcode = 0b1100111;
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-    // Set funct3 to 000 (per specification)
-    uint32_t funct3 = 0b000;
+        }
 
-    // Encode the instruction using the I-Type encoder
-    uint32_t instruction = encode_I_type(static_cast<uint32_t>(offset), rs1_index, funct3, rd_index, opcode);
+        return 0;
 
-    // Create the assembly instruction string in the correct format
-    std::string asm_str = "jalr " + rd + ", " + rs1 + ", " + std::to_string(offset);
+    }
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+    // Programs and distinct-only streams are not positions in the stream,
+    // so there is nothing to save or resume
+    if ((checkpoint_path || resume_path) && (program_mode || unique_per_instr > 0 || dedup)) {
 
-}
+        std::cerr << "error: --checkpoint and --resume do not apply to --program, --unique or --dedup\n";
+        return 1;
 
-std::pair<std::string, uint32_t> gen_rand_branch(const std::string& instr_name, uint32_t funct3) {
+    }
 
-    // Randomly select rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+    // A checkpoint replaces the stream options and, unless --start says
+    // otherwise, continues where its run stopped
+    std::unique_ptr<Checkpoint> resumed;
 
-    // Randomly select rs2 register
-    std::string rs2 = select_random_register();
-    uint32_t rs2_index = register_map[rs2];
+    if (resume_path) {
 
-    // Generate a signed random 12-bit number in the range [-4096, 4095]
-    int32_t offset = (std::rand() % (1 << 12)) - (1 << 11);
+        try {
 
-    // Ensure the offset is even by clearing the least significant bit
-    offset &= ~0x1;
+            resumed = std::make_unique<Checkpoint>(load_checkpoint(resume_path));
 
-    // Set the opcode for a branch type instruction
-    uint32_t opcode = 0b1100011;
+        } catch (const std::exception& e) {
 
-    // Encode the instruction using the B-Type encoder
-    uint32_t instruction = encode_B_type(static_cast<uint32_t>(offset), rs2_index, rs1_index, funct3, opcode);
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-    // Generate the assembly instruction string
-    std::string asm_str = instr_name + " " + rs1 + ", " + rs2 + ", " + std::to_string(offset);
+        }
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+        config = resumed->config;
+        seed_given = true;
 
-}
+        if (!start_given) {
 
+            start_index = resumed->position;
 
-std::pair<std::string, uint32_t> gen_rand_BEQ() {
+        }
 
-    return gen_rand_branch("beq", 0b000);
+    }
 
-}
+    if (start_given && (program_mode || coverage_target > 0 || unique_per_instr > 0 || dedup)) {
 
+        std::cerr << "error: --start does not apply to --program, --coverage-target, --unique or --dedup\n";
+        return 1;
 
+    }
 
-std::pair<std::string, uint32_t> gen_rand_BNE() {
+    // Without an explicit seed, derive one from the clock and report it so
+    // the run can be reproduced with --seed
+    if (!seed_given) {
 
-    return gen_rand_branch("bne", 0b001);
+        config.seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        std::cerr << "seed: " << config.seed << "\n";
 
-}
+    }
 
+    // Hazard percentages are only checked once all options are in
+    try {
 
-std::pair<std::string, uint32_t> gen_rand_BLT() {
+        make_hazard_table(config.hazards);
 
-    return gen_rand_branch("blt", 0b100);
+    } catch (const std::invalid_argument& e) {
 
-}
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
 
+    }
 
+    // Every instruction weighted zero or masked off leaves nothing to draw
+    GenTables tables = make_gen_tables(config);
 
-std::pair<std::string, uint32_t> gen_rand_BGE() {
+    if (tables.sampler.count == 0) {
 
-    return gen_rand_branch("bge", 0b101);
+        std::cerr << "error: the instruction mix is empty\n";
+        return 1;
 
-}
+    }
 
+    if (fuzz) {
 
+        // Round-trip the first --count instructions of this stream
+        return fuzz_round_trip(config, count, threads, std::cout).mismatches == 0 ? 0 : 1;
 
-std::pair<std::string, uint32_t> gen_rand_BLTU() {
+    }
 
-    return gen_rand_branch("bltu", 0b110);
+    if (mix_report) {
 
-}
+        // Replay the stream and compare the achieved mix with the requested one
+        report_mix(config, count, std::cout);
+        return 0;
 
+    }
 
+    if (serve_path) {
 
-std::pair<std::string, uint32_t> gen_rand_BGEU() {
+        // Stimulus server: mix 0 is this configuration, mix k the same with
+        // the weights of the k-th --serve-mix file
+        std::vector<GenConfig> mixes{config};
 
-    return gen_rand_branch("bgeu", 0b111);
+        try {
 
-}
+            for (const char* path : serve_mixes) {
 
+                GenConfig mix = config;
+                mix.weights = uniform_weights();
+                load_mix_file(path, mix.weights);
+                mixes.push_back(mix);
 
-std::pair<std::string, uint32_t> gen_rand_load(const std::string& instr_name, uint32_t funct3) {
+            }
 
-    // Randomly select an rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+            // SIGINT and SIGTERM are taken by a thread of their own, which
+            // stops the server so it can remove its socket
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGINT);
+            sigaddset(&set, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &set, nullptr);
 
-    // Randomly select an rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+            StimulusServer server(serve_path, mixes);
 
-    // Generate a random signed 11-bit offset in the range [-2048, 2047]
-    int32_t offset = (std::rand() % (1 << 12)) - (1 << 11);
+            std::thread([set, &server]() {
 
-    // Set the opcode for a load instruction
-    uint32_t opcode = 0b0000011;
+                int sig;
 
-    // Encode the instruction using the I-Type encoder
-    uint32_t instruction = encode_I_type(static_cast<uint32_t>(offset), rs1_index, funct3, rd_index, opcode);
+                if (sigwait(&set, &sig) == 0) {
 
-    // Create the assembly instruction string
-    std::string asm_str = instr_name + " " + rd + ", " + std::to_string(offset) + "(" + rs1 + ")";
+                    server.stop();
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+                }
 
-}
+            }).detach();
 
+            std::cerr << "serving on " << serve_path << " (" << mixes.size() << " mix" << (mixes.size() > 1 ? "es" : "") << ")\n";
+            server.run();
 
-std::pair<std::string, uint32_t> gen_rand_LB() {
+        } catch (const std::exception& e) {
 
-    return gen_rand_load("lb", 0b000);
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-}
+        }
 
+        return 0;
 
+    }
 
+    if (hazard_report) {
 
-std::pair<std::string, uint32_t> gen_rand_LH() {
+        // Replay the stream and measure its dependency distances
+        report_hazards(config, count, std::cout);
+        return 0;
 
-    return gen_rand_load("lh", 0b001);
+    }
 
-}
+    if (simulate) {
 
+        // Run the generated stream on the built-in simulator as a program
+        // loaded at the ELF text base
+        try {
 
+            std::vector<uint32_t> program;
 
-std::pair<std::string, uint32_t> gen_rand_LW() {
+            if (program_mode) {
 
-    return gen_rand_load("lw", 0b010);
+                program = encode_program(build_program(config, count, jump_reach));
 
-}
+            } else {
 
+                ShardedStream stream(config);
+                stream.seek(start_index);
+                program.resize(count);
+                stream.generate(program.data(), count, threads);
 
+            }
 
-std::pair<std::string, uint32_t> gen_rand_LBU() {
-    
-    return gen_rand_load("lbu", 0b100);
+            Iss iss(program.data(), program.size());
+            std::unique_ptr<CommitLog> log;
 
-}
+            if (commit_log_path) {
 
+                log = std::make_unique<CommitLog>(commit_log_path);
 
-std::pair<std::string, uint32_t> gen_rand_LHU() {
+            }
 
-    return gen_rand_load("lhu", 0b101);
+            auto start = std::chrono::steady_clock::now();
+            IssResult result = iss.run(max_steps, log.get());
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-}
+            if (log) {
 
+                log->flush();
 
-std::pair<std::string, uint32_t> gen_rand_store(const std::string& instr_name, uint32_t funct3) {
+            }
 
-    // Randomly select rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+            std::cerr << "retired: " << result.retired << "\n"
+                      << "stop: " << stop_reason_name(result.reason) << " at pc 0x" << std::hex << result.pc << std::dec << "\n"
+                      << "pages: " << iss.memory().pages_allocated() << "\n"
+                      << "time: " << seconds << " s (" << result.retired / seconds / 1e6 << " MIPS)\n";
 
-    // Randomly select rs2 register
-    std::string rs2 = select_random_register();
-    uint32_t rs2_index = register_map[rs2];
+            // A generated program must always reach its halt loop
+            if (program_mode && result.reason != StopReason::HALT) {
 
-    // Generate a random signed 11-bit offset in the range [-2048, 2047]
-    int32_t offset = (std::rand() % (1 << 12)) - (1 << 11);
+                return 1;
 
-    // Set the opcode for a store instruction
-    uint32_t opcode = 0b0100011;
+            }
 
-    // Encode the instruction using the S-Type encoder
-    uint32_t instruction = encode_S_type(static_cast<uint32_t>(offset), rs2_index, rs1_index, funct3, opcode);
+        } catch (const std::exception& e) {
 
-    // Create the assembly instruction string
-    std::string asm_str = instr_name + " " + rs2 + ", " + std::to_string(offset) + "(" + rs1 + ")";
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+        }
 
-}
+        return 0;
 
+    }
 
+    if (program_mode) {
 
-std::pair<std::string, uint32_t> gen_rand_SB() {
+        // Self-contained program: prologue, forward-only body, halt loop
+        try {
 
-    return gen_rand_store("sb", 0b000);
+            Program program = build_program(config, count, jump_reach);
 
-}
+            if (text_output) {
 
+                AsmWriter writer(output_path);
+                writer.write(program.records.data(), program.records.size());
+                writer.finish();
 
+            } else {
 
-std::pair<std::string, uint32_t> gen_rand_SH() {
+                std::vector<uint32_t> words = encode_program(program);
+                std::unique_ptr<OutputWriter> writer = open_output(format, output_path);
+                writer->write(words.data(), words.size());
+                writer->finish();
 
-    return gen_rand_store("sh", 0b001);
+            }
 
-}
+            std::cerr << "sandbox: 0x" << std::hex << program.sandbox_base << std::dec << ", " << program.sandbox_size << " bytes\n";
 
+        } catch (const std::exception& e) {
 
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-std::pair<std::string, uint32_t> gen_rand_SW() {
+        }
 
-    return gen_rand_store("sw", 0b010);
+        return 0;
 
-}
+    }
 
+    // Coverage from earlier runs is merged in before generating
+    bool track_coverage = coverage_target > 0 || !coverage_inputs.empty() || coverage_output || coverage_report ||
+                          (resumed && resumed->has_coverage);
+    CoverageMap coverage;
 
-std::pair<std::string, uint32_t> gen_rand_immediate(const std::string& instr_name, uint32_t funct3) {
+    if (resumed && resumed->has_coverage) {
 
-    // Randomly select rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+        coverage.merge(resumed->coverage);
 
-    // Randomly select rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+    }
 
-    // Generate a random signed 11-bit immediate in the range [-2048, 2047]
-    int32_t imm = (std::rand() % (1 << 12)) - (1 << 11);
+    for (const char* path : coverage_inputs) {
 
-    // Set the opcode for an immediate instruction
-    uint32_t opcode = 0b0010011;
+        try {
 
-    // Encode the instruction using the I-Type encoder
-    uint32_t instruction = encode_I_type(static_cast<uint32_t>(imm), rs1_index, funct3, rd_index, opcode);
+            coverage.load(path);
 
-    // Create the assembly instruction string
-    std::string asm_str = instr_name + " " + rd + ", " + rs1 + ", " + std::to_string(imm);
+        } catch (const std::exception& e) {
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-}
+        }
 
+    }
 
+    if (coverage_target > 0) {
 
-std::pair<std::string, uint32_t> gen_rand_ADDI() {
+        // Coverage-driven generation: run until the target is reached, or
+        // for at most --count instructions when one is given
+        size_t limit = count_given ? count : SIZE_MAX;
+        size_t done = 0;
 
-    return gen_rand_immediate("addi", 0b000);
+        try {
 
-}
+            CoverageDriver driver(config, coverage);
+            std::unique_ptr<OutputWriter> writer;
+            std::unique_ptr<AsmWriter> asm_writer;
 
+            if (text_output) {
 
+                asm_writer = std::make_unique<AsmWriter>(output_path);
 
-std::pair<std::string, uint32_t> gen_rand_SLTI() {
+            } else {
 
-    return gen_rand_immediate("slti", 0b010);
+                writer = open_output(format, output_path);
 
-}
+            }
 
+            std::vector<InstrRecord> records(SHARD_SIZE);
+            std::vector<uint32_t> words(SHARD_SIZE);
 
+            while (done < limit) {
 
-std::pair<std::string, uint32_t> gen_rand_SLTIU() {
+                size_t n = driver.generate(records.data(), std::min(records.size(), limit - done), coverage_target);
 
-    return gen_rand_immediate("sltiu", 0b011);
+                if (n == 0) {
 
-}
+                    break;
 
+                }
 
+                if (asm_writer) {
 
-std::pair<std::string, uint32_t> gen_rand_XORI() {
+                    asm_writer->write(records.data(), n);
 
-    return gen_rand_immediate("xori", 0b100);
+                } else {
 
-}
+                    for (size_t i = 0; i < n; ++i) {
 
+                        words[i] = encode_record(records[i]);
 
-std::pair<std::string, uint32_t> gen_rand_ORI() {
+                    }
 
-    return gen_rand_immediate("ori", 0b110);
+                    writer->write(words.data(), n);
 
-}
+                }
 
+                done += n;
 
+            }
 
-std::pair<std::string, uint32_t> gen_rand_ANDI() {
+            if (asm_writer) {
 
-    return gen_rand_immediate("andi", 0b111);
+                asm_writer->finish();
 
-}
+            } else {
 
-std::pair<std::string, uint32_t> gen_rand_AND() {
+                writer->finish();
 
-    return gen_rand_register("and", 0b111, 0b0000000);
+            }
 
-}
+            std::cerr << "generated: " << done << " (" << driver.steered() << " steered)\n";
 
+        } catch (const std::exception& e) {
 
-std::pair<std::string, uint32_t> gen_rand_shift(const std::string& instr_name, uint32_t funct3, uint32_t funct7) {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-    // Randomly select rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+        }
 
-    // Randomly select rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+        // A resumed coverage-driven run starts a new steered stream from
+        // the saved coverage, so only the map carries over
+        bool ok = finish_coverage(coverage, config, coverage_output, true);
+        return ok && (!checkpoint_path || write_checkpoint(checkpoint_path, config, done, &coverage)) ? 0 : 1;
 
-    // Generate a random unsigned 5-bit shift amount in the range [0, 31]
-    uint32_t shamt = std::rand() % 32;
+    }
 
-    // Set the opcode for a shift instruction
-    uint32_t opcode = 0b0010011;
+    if (unique_per_instr > 0 || dedup) {
 
-    // Combine funct7 and shamt for the immediate field
-    uint32_t imm = (funct7 << 5) | shamt;
+        // Distinct encodings only. --unique walks a keyed permutation of
+        // every instruction's field space (no constraints, no memory);
+        // --dedup drops repeats from the regular stream with a bitmap.
+        if (unique_per_instr > 0 && (dedup || tables.regs.active || tables.hazards.active)) {
 
-    // Encode the instruction using the I-Type encoder
-    uint32_t instruction = encode_I_type(imm, rs1_index, funct3, rd_index, opcode);
+            std::cerr << "error: --unique does not take register constraints or hazards; use --dedup for those\n";
+            return 1;
 
-    // Create the assembly instruction string
-    std::string asm_str = instr_name + " " + rd + ", " + rs1 + ", " + std::to_string(shamt);
+        }
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+        size_t done = 0;
 
-}
+        try {
 
+            std::unique_ptr<UniqueStream> unique;
+            std::unique_ptr<DedupFilter> filter;
+            std::unique_ptr<OutputWriter> writer;
+            std::unique_ptr<AsmWriter> asm_writer;
+            size_t limit = count;
 
+            if (unique_per_instr > 0) {
 
-std::pair<std::string, uint32_t> gen_rand_SLLI() {
+                unique = std::make_unique<UniqueStream>(config, unique_per_instr);
+                limit = count_given ? std::min<uint64_t>(count, unique->size()) : unique->size();
 
-    return gen_rand_shift("slli", 0b001, 0b0000000);
+            } else {
 
-}
+                filter = std::make_unique<DedupFilter>(config.instr_mask);
 
+            }
 
+            if (text_output) {
 
+                asm_writer = std::make_unique<AsmWriter>(output_path);
 
-std::pair<std::string, uint32_t> gen_rand_SRLI() {
+            } else {
 
-    return gen_rand_shift("srli", 0b101, 0b0000000);
+                writer = open_output(format, output_path);
 
-}
+            }
 
+            std::vector<InstrRecord> records(SHARD_SIZE);
+            std::vector<uint32_t> words(SHARD_SIZE);
+            unsigned empty_shards = 0;
 
+            for (uint64_t shard = 0; done < limit; ++shard) {
 
-std::pair<std::string, uint32_t> gen_rand_SRAI() {
+                size_t n = 0;
 
-    return gen_rand_shift("srai", 0b101, 0b0100000);
+                if (unique) {
 
-}
+                    n = unique->generate(records.data(), std::min(records.size(), limit - done));
 
-std::pair<std::string, uint32_t> gen_rand_register(const std::string& instr_name, uint32_t funct3, uint32_t funct7) {
+                } else {
 
-    // Randomly select rd register
-    std::string rd = select_random_register();
-    uint32_t rd_index = register_map[rd];
+                    // The regular stream, shard by shard, without repeats
+                    Rng rng(config.rng, config.seed, shard);
+                    size_t drawn = generate_records(records.data(), records.size(), config, rng);
 
-    // Randomly select rs1 register
-    std::string rs1 = select_random_register();
-    uint32_t rs1_index = register_map[rs1];
+                    for (size_t i = 0; i < drawn && done + n < limit; ++i) {
 
-    // Randomly select rs2 register
-    std::string rs2 = select_random_register();
-    uint32_t rs2_index = register_map[rs2];
+                        if (filter->insert(records[i])) {
 
-    // Set the opcode for a register instruction
-    uint32_t opcode = 0b0110011;
+                            records[n++] = records[i];
 
-    // Encode the instruction using the R-Type encoder
-    uint32_t instruction = encode_R_type(funct7, rs2_index, rs1_index, funct3, rd_index, opcode);
+                        }
 
-    // Create the assembly instruction string
-    std::string asm_str = instr_name + " " + rd + ", " + rs1 + ", " + rs2;
+                    }
 
-    // Return the assembly string and the encoded instruction
-    return {asm_str, instruction};
+                }
 
-}
+                if (n == 0) {
 
+                    // Many shards in a row without a new record: the
+                    // reachable space is (all but) used up
+                    if (unique || ++empty_shards == 16) {
 
+                        std::cerr << "warning: only " << done << " distinct instructions found\n";
+                        break;
 
-std::pair<std::string, uint32_t> gen_rand_ADD() {
+                    }
 
-    return gen_rand_register("add", 0b000, 0b0000000);
+                    continue;
 
-}
+                }
 
+                empty_shards = 0;
 
-std::pair<std::string, uint32_t> gen_rand_SUB() {
+                if (asm_writer) {
 
-    return gen_rand_register("sub", 0b000, 0b0100000);
+                    asm_writer->write(records.data(), n);
 
-}
+                } else {
 
+                    for (size_t i = 0; i < n; ++i) {
 
+                        words[i] = encode_record(records[i]);
 
-std::pair<std::string, uint32_t> gen_rand_SLL() {
+                    }
 
-    return gen_rand_register("sll", 0b001, 0b0000000);
+                    writer->write(words.data(), n);
 
-}
+                }
 
+                if (track_coverage) {
 
+                    for (size_t i = 0; i < n; ++i) {
 
-std::pair<std::string, uint32_t> gen_rand_SLT() {
+                        coverage.sample_word(encode_record(records[i]));
 
-    return gen_rand_register("slt", 0b010, 0b0000000);
+                    }
 
-}
+                }
 
+                done += n;
 
+            }
 
-std::pair<std::string, uint32_t> gen_rand_SLTU() {
+            if (asm_writer) {
 
-    return gen_rand_register("sltu", 0b011, 0b0000000);
+                asm_writer->finish();
 
-}
+            } else {
 
+                writer->finish();
 
+            }
 
-std::pair<std::string, uint32_t> gen_rand_XOR() {
+        } catch (const std::exception& e) {
 
-    return gen_rand_register("xor", 0b100, 0b0000000);
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-}
+        }
 
+        return !track_coverage || finish_coverage(coverage, config, coverage_output, coverage_report) ? 0 : 1;
 
+    }
 
+    if (mmap_output) {
 
-std::pair<std::string, uint32_t> gen_rand_SRL() {
+        // Parallel writer: every thread generates its shards straight into
+        // the mapped output file
+        if (text_output || format != OutputFormat::BIN || !output_path || std::strcmp(output_path, "-") == 0 || track_coverage ||
+            start_index != 0) {
 
-    return gen_rand_register("srl", 0b101, 0b0000000);
+            std::cerr << "error: --mmap needs --format bin, --output FILE, no coverage options and no --start\n";
+            return 1;
 
-}
+        }
 
+        try {
 
+            write_bin_mapped(output_path, count, config, threads, mmap_options);
 
+        } catch (const std::exception& e) {
 
-std::pair<std::string, uint32_t> gen_rand_SRA() {
+            std::cerr << "error: " << e.what() << "\n";
+            return 1;
 
-    return gen_rand_register("sra", 0b101, 0b0100000);
+        }
 
-}
+        return !checkpoint_path || write_checkpoint(checkpoint_path, config, count, nullptr) ? 0 : 1;
 
+    }
 
+    try {
 
+        // Generation on this thread overlaps output on a writer thread.
+        // Encodings-only output hands whole shards to the workers, so the
+        // stream is the same for every thread count, from any --start;
+        // the assembly listing is drawn up to a shard boundary at a time
+        // and rendered by the writer.
+        if (text_output) {
 
-std::pair<std::string, uint32_t> gen_rand_OR() {
+            AsmWriter writer(output_path);
+            pipe_records(writer, config, start_index, count, pipeline_options, track_coverage ? &coverage : nullptr);
+            writer.finish();
 
-    return gen_rand_register("or", 0b110, 0b0000000);
+        } else {
 
-}
+            std::unique_ptr<OutputWriter> writer = open_output(format, output_path, &config, start_index);
+            pipeline_options.block_size = SHARD_SIZE * threads * 4;
+            pipe_words(*writer, config, start_index, count, threads, pipeline_options, track_coverage ? &coverage : nullptr);
+            writer->finish();
 
+        }
+
+    } catch (const std::exception& e) {
 
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+
+    }
 
-uint32_t encode_R_type(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    bool ok = !track_coverage || finish_coverage(coverage, config, coverage_output, coverage_report);
+    return ok && (!checkpoint_path || write_checkpoint(checkpoint_path, config, start_index + count, track_coverage ? &coverage : nullptr)) ? 0 : 1;
 
-    return ((funct7 & 0x7F) << 25) |        // funct7 field (7 bits)
-           ((rs2 & 0x1F) << 20)  |          // rs2 field (5 bits)
-           ((rs1 & 0x1F) << 15)  |          // rs1 field (5 bits)
-           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
-           ((rd & 0x1F) << 7)    |          // rd field (5 bits)
-           (opcode & 0x7F);                 // opcode field (7 bits)
-    
 }
 
 
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
 
-uint32_t encode_I_type(uint32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+bool parse_rng_kind(const char* name, RngKind& kind) {
 
-    return ((imm & 0xFFF) << 20) |          // Immediate field (12 bits)
-            ((rs1 & 0x1F) << 15)  |         // rs1 field (5 bits)
-            ((funct3 & 0x7) << 12) |        // funct3 field (3 bits)
-            ((rd & 0x1F) << 7)    |         // rd field (5 bits)
-            (opcode & 0x7F);                // opcode field (7 bits)
-    
-}
+    if (std::strcmp(name, "xoshiro") == 0) {
+
+        kind = RngKind::XOSHIRO;
+        return true;
+
+    }
 
+    if (std::strcmp(name, "philox") == 0) {
 
+        kind = RngKind::PHILOX;
+        return true;
 
-uint32_t encode_S_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+    }
 
-    uint32_t imm11_5 = (imm >> 5) & 0x7F;   // Extract bits [11:5] of immediate
-    uint32_t imm4_0 = imm & 0x1F;           // Extract bits [4:0] of immediate
+    return false;
 
-    return (imm11_5 << 25) |                // imm[11:5] field (7 bits)
-           ((rs2 & 0x1F) << 20) |           // rs2 field (5 bits)
-           ((rs1 & 0x1F) << 15) |           // rs1 field (5 bits)
-           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
-           (imm4_0 << 7) |                  // imm[4:0] field (5 bits)
-           (opcode & 0x7F);                 // opcode field (7 bits)
-    
 }
 
 
 
-uint32_t encode_B_type(uint32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+bool parse_reg_list(const char* list, uint32_t& mask) {
+
+    // Comma-separated register names, e.g. "x2,x3,x8"
+    mask = 0;
+
+    for (const char* p = list; *p; ) {
+
+        char* end;
+
+        if (*p != 'x') {
+
+            return false;
+
+        }
+
+        unsigned long index = std::strtoul(p + 1, &end, 10);
+
+        if (end == p + 1 || index > 31 || (*end != ',' && *end != '\0')) {
+
+            return false;
 
-    uint32_t imm12 = (imm >> 12) & 0x1;     // Extract bit 12
-    uint32_t imm10_5 = (imm >> 5) & 0x3F;   // Extract bits [10:5]
-    uint32_t imm4_1 = (imm >> 1) & 0xF;     // Extract bits [4:1]
-    uint32_t imm11 = (imm >> 11) & 0x1;     // Extract bit 11
+        }
+
+        mask |= uint32_t{1} << index;
+        p = (*end == ',') ? end + 1 : end;
+
+    }
+
+    return mask != 0;
 
-    return (imm12 << 31) |                  // imm[12] field (1 bit)
-           (imm10_5 << 25) |                // imm[10:5] field (6 bits)
-           ((rs2 & 0x1F) << 20) |           // rs2 field (5 bits)
-           ((rs1 & 0x1F) << 15) |           // rs1 field (5 bits)
-           ((funct3 & 0x7) << 12) |         // funct3 field (3 bits)
-           (imm4_1 << 8) |                  // imm[4:1] field (4 bits)
-           (imm11 << 7) |                   // imm[11] field (1 bit)
-           (opcode & 0x7F);                 // opcode field (7 bits)
-    
 }
 
 
 
-uint32_t encode_U_type(uint32_t imm, uint32_t rd, uint32_t opcode) {
+bool verify_disassembly(const GenConfig& config, size_t n, std::ostream& log) {
+
+    // The text the generator prints must be what its encoding disassembles to
+    GenTables tables = make_gen_tables(config);
+    Rng rng(config.rng, config.seed);
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < n; ++i) {
+
+        InstrRecord rec = draw_instr(rng, tables, rng.scoreboard());
+        std::string asm_text = format_instr(rec);
+        std::string text = disassemble(encode_record(rec));
+
+        if (text != asm_text && ++mismatches <= 8) {
+
+            log << "  mismatch: " << asm_text << " -> " << text << "\n";
+
+        }
+
+    }
+
+    log << "disassembly: " << n << " instructions, " << mismatches << " mismatches\n";
+    return mismatches == 0;
 
-    return ((imm & 0xFFFFF) << 12) |        // Immediate field (20 bits)
-           ((rd & 0x1F) << 7) |             // rd field (5 bits)
-           (opcode & 0x7F);                 // opcode field (7 bits)
-    
 }
 
 
 
-uint32_t encode_J_type(uint32_t imm, uint32_t rd, uint32_t opcode) {
+bool finish_coverage(const CoverageMap& coverage, const GenConfig& config, const char* out_path, bool report) {
 
-    uint32_t imm20 = (imm >> 20) & 0x1;         // Extract bit 20
-    uint32_t imm10_1 = (imm >> 1) & 0x3FF;      // Extract bits [10:1]
-    uint32_t imm11 = (imm >> 11) & 0x1;         // Extract bit 11
-    uint32_t imm19_12 = (imm >> 12) & 0xFF;     // Extract bits [19:12]
+    // Report against the bins this config can reach, then save for merging
+    if (report) {
+
+        report_coverage(coverage, coverage_goal(config), std::cerr);
+
+    }
+
+    if (out_path) {
+
+        try {
+
+            coverage.save(out_path);
+
+        } catch (const std::exception& e) {
+
+            std::cerr << "error: " << e.what() << "\n";
+            return false;
+
+        }
+
+    }
+
+    return true;
 
-    return (imm20 << 31) |                      // imm[20] field (1 bit)
-           (imm19_12 << 12) |                   // imm[19:12] field (8 bits)
-           (imm11 << 20) |                      // imm[11] field (1 bit)
-           (imm10_1 << 21) |                    // imm[10:1] field (10 bits)
-           ((rd & 0x1F) << 7) |                 // rd field (5 bits)
-           (opcode & 0x7F);                     // opcode field (7 bits)
-    
 }
 
+
+
+bool write_checkpoint(const char* path, const GenConfig& config, uint64_t position, const CoverageMap* coverage) {
+
+    // Everything needed to continue the stream, or to regenerate any part of it
+    Checkpoint checkpoint;
+    checkpoint.config = config;
+    checkpoint.position = position;
+
+    if (coverage) {
+
+        checkpoint.has_coverage = true;
+        checkpoint.coverage = *coverage;
+
+    }
+
+    try {
+
+        save_checkpoint(path, checkpoint);
+
+    } catch (const std::exception& e) {
+
+        std::cerr << "error: " << e.what() << "\n";
+        return false;
+
+    }
+
+    return true;
+
+}
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "mapped_output.h"
+#include "shard.h"
+#include "stats.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+constexpr uint64_t SHARD_BYTES = 4 * uint64_t{SHARD_SIZE};
+
+std::system_error io_error(const std::string& what) {
+
+    return std::system_error(errno, std::generic_category(), what);
+
+}
+
+// File descriptor and mapping released on every exit path
+struct MappedFile {
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t length = 0;
+
+    ~MappedFile() {
+
+        if (base) {
+
+            ::munmap(base, length);
+
+        }
+
+        if (fd >= 0) {
+
+            ::close(fd);
+
+        }
+
+    }
+
+};
+
+// Give the file its final size with its blocks allocated, so a page fault
+// in the mapping can never run out of space (SIGBUS)
+void preallocate(int fd, uint64_t size) {
+
+#ifdef __linux__
+    if (::fallocate(fd, 0, 0, static_cast<off_t>(size)) == 0) {
+
+        return;
+
+    }
+
+    // Filesystems without fallocate (e.g. some network filesystems) get a
+    // sparse file instead
+    if (errno != EOPNOTSUPP) {
+
+        throw io_error("cannot preallocate output");
+
+    }
+#endif
+
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+
+        throw io_error("cannot size output");
+
+    }
+
+}
+
+
+
+// Queue a filled window for writeback without waiting
+void start_writeback(const MappedFile& file, uint64_t offset, size_t len) {
+
+    StageTimer timer(Stage::OUTPUT);
+
+#ifdef __linux__
+    if (::sync_file_range(file.fd, static_cast<off_t>(offset), static_cast<off_t>(len), SYNC_FILE_RANGE_WRITE) != 0) {
+
+        throw io_error("sync_file_range failed");
+
+    }
+#else
+    if (::msync(file.base + offset, len, MS_ASYNC) != 0) {
+
+        throw io_error("msync failed");
+
+    }
+#endif
+
+}
+
+
+
+// Wait until a window is on disk, then drop it from the mapping and the
+// page cache so a large corpus does not evict everything else
+void retire_window(const MappedFile& file, uint64_t offset, size_t len) {
+
+    StageTimer timer(Stage::OUTPUT);
+
+#ifdef __linux__
+    if (::sync_file_range(file.fd, static_cast<off_t>(offset), static_cast<off_t>(len),
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+
+        throw io_error("sync_file_range failed");
+
+    }
+#else
+    if (::msync(file.base + offset, len, MS_SYNC) != 0) {
+
+        throw io_error("msync failed");
+
+    }
+#endif
+
+    // Advisory only; a failure leaves the pages cached
+    ::madvise(file.base + offset, len, MADV_DONTNEED);
+    ::posix_fadvise(file.fd, static_cast<off_t>(offset), static_cast<off_t>(len), POSIX_FADV_DONTNEED);
+
+}
+
+} // namespace
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+void write_bin_mapped(const char* path, size_t count, const GenConfig& config, unsigned threads,
+                      const MappedOutputOptions& options) {
+
+    if (make_gen_tables(config).sampler.count == 0) {
+
+        throw std::invalid_argument("the instruction mix is empty");
+
+    }
+
+    MappedFile file;
+    file.fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (file.fd < 0) {
+
+        throw io_error(std::string("cannot open ") + path);
+
+    }
+
+    uint64_t size = 4 * static_cast<uint64_t>(count);
+
+    if (size == 0) {
+
+        return;
+
+    }
+
+    preallocate(file.fd, size);
+
+    int flags = MAP_SHARED;
+
+#ifdef MAP_POPULATE
+    if (options.populate) {
+
+        flags |= MAP_POPULATE;
+
+    }
+#endif
+
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, file.fd, 0);
+
+    if (base == MAP_FAILED) {
+
+        throw io_error("cannot map output");
+
+    }
+
+    file.base = static_cast<char*>(base);
+    file.length = size;
+
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) {
+
+        // Advisory; most filesystems only support huge pages for anonymous
+        // and tmpfs memory
+        ::madvise(file.base, size, MADV_HUGEPAGE);
+
+    }
+#endif
+
+    // Shards per claim: one writeback window, but small enough that every
+    // thread gets work on short runs
+    uint64_t shard_count = (count + SHARD_SIZE - 1) / SHARD_SIZE;
+    threads = static_cast<unsigned>(std::min<uint64_t>(resolve_threads(threads), shard_count));
+    uint64_t window_shards = options.window_bytes ? std::max<uint64_t>(1, options.window_bytes / SHARD_BYTES) : UINT64_MAX;
+    uint64_t claim = std::max<uint64_t>(1, std::min(window_shards, (shard_count + threads - 1) / threads));
+    uint64_t claim_count = (shard_count + claim - 1) / claim;
+
+    std::atomic<uint64_t> next_claim{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+
+        try {
+
+            uint64_t prev_offset = 0;
+            size_t prev_len = 0;
+
+            for (uint64_t c = next_claim.fetch_add(1, std::memory_order_relaxed); c < claim_count && !failed.load(std::memory_order_relaxed);
+                 c = next_claim.fetch_add(1, std::memory_order_relaxed)) {
+
+                uint64_t first = c * claim;
+                uint64_t last = std::min(first + claim, shard_count);
+
+                // Shard s of the stream lands at its own offset in the file
+                for (uint64_t s = first; s < last; ++s) {
+
+                    uint64_t begin = s * SHARD_SIZE;
+                    size_t len = static_cast<size_t>(std::min<uint64_t>(SHARD_SIZE, count - begin));
+                    uint32_t* out = reinterpret_cast<uint32_t*>(file.base) + begin;
+
+                    Rng rng(config.rng, config.seed, s);
+                    generate_batch(out, len, config, rng);
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+                    // The file is little-endian whatever the host order
+                    for (size_t i = 0; i < len; ++i) {
+
+                        uint32_t w = out[i];
+                        unsigned char* p = reinterpret_cast<unsigned char*>(out + i);
+                        p[0] = static_cast<unsigned char>(w);
+                        p[1] = static_cast<unsigned char>(w >> 8);
+                        p[2] = static_cast<unsigned char>(w >> 16);
+                        p[3] = static_cast<unsigned char>(w >> 24);
+
+                    }
+#endif
+
+                }
+
+                if (options.window_bytes == 0) {
+
+                    continue;
+
+                }
+
+                // Start this window's writeback, finish the previous one
+                uint64_t offset = first * SHARD_BYTES;
+                size_t len = static_cast<size_t>(std::min(last * SHARD_BYTES, size) - offset);
+                start_writeback(file, offset, len);
+
+                if (prev_len > 0) {
+
+                    retire_window(file, prev_offset, prev_len);
+
+                }
+
+                prev_offset = offset;
+                prev_len = len;
+
+            }
+
+            if (prev_len > 0) {
+
+                retire_window(file, prev_offset, prev_len);
+
+            }
+
+        } catch (...) {
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+
+            if (!error) {
+
+                error = std::current_exception();
+
+            }
+
+            failed.store(true, std::memory_order_relaxed);
+
+        }
+
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        pool.emplace_back(worker);
+
+    }
+
+    worker();
+
+    for (std::thread& th : pool) {
+
+        th.join();
+
+    }
+
+    if (error) {
+
+        std::rethrow_exception(error);
+
+    }
+
+}
@@ -0,0 +1,45 @@
+#ifndef MAPPED_OUTPUT_H
+#define MAPPED_OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "generator.h"
+
+//-------------------------------------------------
+// Parallel Memory-Mapped Binary Output
+//
+// For corpora too large for a single writer: the output file is
+// preallocated to its final size and mapped, and every worker generates
+// its shards straight into the mapping at offset 4 * shard * SHARD_SIZE.
+// Nothing is copied and no thread waits for another. The bytes are the
+// same as --format bin for any thread count.
+//
+// Workers claim runs of shards ("windows"). After filling one, a worker
+// starts its writeback (sync_file_range, or msync(MS_ASYNC) elsewhere),
+// then waits for its previous window and drops it from the page cache.
+// Dirty memory therefore stays near two windows per thread.
+//-------------------------------------------------
+
+struct MappedOutputOptions {
+
+    // Bytes per writeback window (rounded to whole shards); 0 leaves
+    // writeback to the kernel and keeps the pages cached
+    size_t window_bytes = size_t{64} << 20;
+
+    // Pre-fault the whole mapping (MAP_POPULATE)
+    bool populate = false;
+
+    // Ask for transparent huge pages (MADV_HUGEPAGE), where the filesystem supports them
+    bool huge_pages = false;
+
+};
+
+// Write instructions [0, count) of config's stream to path as raw
+// little-endian words using up to `threads` workers. path must name a
+// regular file. Throws std::system_error on I/O failure and
+// std::invalid_argument if the instruction mix is empty.
+void write_bin_mapped(const char* path, size_t count, const GenConfig& config, unsigned threads,
+                      const MappedOutputOptions& options = {});
+
+#endif // MAPPED_OUTPUT_H
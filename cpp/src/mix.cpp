@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <strings.h>
+
+#include "mix.h"
+#include "generator.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+InstrSampler make_sampler(uint64_t instr_mask, const InstrWeights& weights) {
+
+    InstrSampler sampler;
+
+    // Columns are the instructions that can be drawn at all
+    double total = 0.0;
+
+    for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+        if ((instr_mask & (uint64_t{1} << i)) && weights[i] > 0.0) {
+
+            sampler.primary[sampler.count] = static_cast<uint8_t>(i);
+            sampler.alias[sampler.count] = static_cast<uint8_t>(i);
+            sampler.threshold[sampler.count] = 0x10000;
+            total += weights[i];
+            sampler.count++;
+
+        }
+
+    }
+
+    if (sampler.count == 0) {
+
+        return sampler;
+
+    }
+
+    // Vose's method: scale each weight so the average column holds 1.0, then
+    // repeatedly top up an under-full column from an over-full one
+    double scaled[INSTR_COUNT];
+    uint32_t small[INSTR_COUNT];
+    uint32_t large[INSTR_COUNT];
+    uint32_t small_count = 0;
+    uint32_t large_count = 0;
+
+    for (uint32_t c = 0; c < sampler.count; ++c) {
+
+        scaled[c] = weights[sampler.primary[c]] * sampler.count / total;
+
+        if (scaled[c] < 1.0) {
+
+            small[small_count++] = c;
+
+        } else {
+
+            large[large_count++] = c;
+
+        }
+
+    }
+
+    while (small_count > 0 && large_count > 0) {
+
+        uint32_t s = small[--small_count];
+        uint32_t l = large[large_count - 1];
+
+        sampler.threshold[s] = static_cast<uint32_t>(std::lround(scaled[s] * 0x10000));
+        sampler.alias[s] = sampler.primary[l];
+
+        scaled[l] -= 1.0 - scaled[s];
+
+        if (scaled[l] < 1.0) {
+
+            --large_count;
+            small[small_count++] = l;
+
+        }
+
+    }
+
+    // Leftover columns (rounding residue) are full: threshold stays 65536
+
+    return sampler;
+
+}
+
+
+
+const char* instr_class_name(InstrClass instr_class) {
+
+    switch (instr_class) {
+
+        case InstrClass::UPPER:     return "upper";
+        case InstrClass::JUMP:      return "jump";
+        case InstrClass::JUMP_REG:  return "jump_reg";
+        case InstrClass::BRANCH:    return "branch";
+        case InstrClass::LOAD:      return "load";
+        case InstrClass::STORE:     return "store";
+        case InstrClass::IMMEDIATE: return "immediate";
+        case InstrClass::SHIFT:     return "shift";
+        case InstrClass::REGISTER:  return "register";
+
+    }
+
+    return "unknown";
+
+}
+
+
+
+void load_mix_file(const char* path, InstrWeights& weights) {
+
+    std::ifstream in(path);
+
+    if (!in) {
+
+        throw std::runtime_error(std::string("cannot open mix file ") + path);
+
+    }
+
+    std::string line;
+    int line_no = 0;
+
+    auto fail = [&](const std::string& what) {
+
+        throw std::runtime_error(std::string(path) + ":" + std::to_string(line_no) + ": " + what);
+
+    };
+
+    while (std::getline(in, line)) {
+
+        ++line_no;
+
+        // Strip comments and skip blank lines
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string name;
+
+        if (!(fields >> name)) {
+
+            continue;
+
+        }
+
+        std::string class_name;
+
+        if (name == "class" && !(fields >> class_name)) {
+
+            fail("missing class name");
+
+        }
+
+        double weight;
+        std::string extra;
+
+        if (!(fields >> weight) || weight < 0.0 || !std::isfinite(weight)) {
+
+            fail("expected a non-negative weight");
+
+        }
+
+        if (fields >> extra) {
+
+            fail("unexpected '" + extra + "'");
+
+        }
+
+        if (name == "default") {
+
+            weights.fill(weight);
+
+        } else if (name == "class") {
+
+            // Split the class total evenly among its members
+            uint32_t members = 0;
+
+            for (const InstrDesc& desc : instr_table) {
+
+                members += class_name == instr_class_name(desc.instr_class);
+
+            }
+
+            if (members == 0) {
+
+                fail("unknown class '" + class_name + "'");
+
+            }
+
+            for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+                if (class_name == instr_class_name(instr_table[i].instr_class)) {
+
+                    weights[i] = weight / members;
+
+                }
+
+            }
+
+        } else {
+
+            // Mnemonics match case-insensitively
+            uint32_t i = 0;
+
+            while (i < INSTR_COUNT && strcasecmp(name.c_str(), instr_table[i].mnemonic) != 0) {
+
+                ++i;
+
+            }
+
+            if (i == INSTR_COUNT) {
+
+                fail("unknown mnemonic '" + name + "'");
+
+            }
+
+            weights[i] = weight;
+
+        }
+
+    }
+
+}
+
+
+
+void report_mix(const GenConfig& config, uint64_t count, std::ostream& out) {
+
+    // Replay the stream's instruction choices shard by shard
+    uint64_t achieved[INSTR_COUNT] = {};
+    InstrRecord records[4096];
+
+    for (uint64_t done = 0; done < count; done += SHARD_SIZE) {
+
+        Rng rng(config.rng, config.seed, done / SHARD_SIZE);
+        uint64_t shard_len = std::min<uint64_t>(SHARD_SIZE, count - done);
+
+        for (uint64_t i = 0; i < shard_len; i += 4096) {
+
+            size_t n = generate_records(records, std::min<uint64_t>(4096, shard_len - i), config, rng);
+
+            for (size_t r = 0; r < n; ++r) {
+
+                achieved[records[r].id]++;
+
+            }
+
+        }
+
+    }
+
+    // Requested share of each instruction after masking
+    double total_weight = 0.0;
+
+    for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+        if (config.instr_mask & (uint64_t{1} << i)) {
+
+            total_weight += std::max(config.weights[i], 0.0);
+
+        }
+
+    }
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-8s %-10s %10s %10s %9s %12s\n",
+                  "instr", "class", "requested", "achieved", "delta", "count");
+    out << line;
+
+    for (uint32_t i = 0; i < INSTR_COUNT; ++i) {
+
+        bool enabled = (config.instr_mask & (uint64_t{1} << i)) && config.weights[i] > 0.0;
+        double requested = enabled && total_weight > 0.0 ? 100.0 * config.weights[i] / total_weight : 0.0;
+        double got = count > 0 ? 100.0 * static_cast<double>(achieved[i]) / static_cast<double>(count) : 0.0;
+
+        std::snprintf(line, sizeof(line), "%-8s %-10s %9.3f%% %9.3f%% %+8.3f%% %12llu\n",
+                      instr_table[i].mnemonic, instr_class_name(instr_table[i].instr_class),
+                      requested, got, got - requested, static_cast<unsigned long long>(achieved[i]));
+        out << line;
+
+    }
+
+}
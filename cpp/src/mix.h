@@ -0,0 +1,81 @@
+#ifndef MIX_H
+#define MIX_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "instr_table.h"
+
+//-------------------------------------------------
+// Instruction Mix
+//
+// Relative per-instruction weights, sampled with a Walker/Vose alias table:
+// one multiply picks a column and the leftover fraction chooses between the
+// column's instruction and its alias, so a draw costs the same for any mix.
+//-------------------------------------------------
+
+using InstrWeights = std::array<double, INSTR_COUNT>;
+
+constexpr InstrWeights uniform_weights() {
+
+    InstrWeights weights{};
+
+    for (double& w : weights) {
+
+        w = 1.0;
+
+    }
+
+    return weights;
+
+}
+
+// Alias table over the instructions with a positive weight
+struct InstrSampler {
+
+    // Column c yields primary[c] when the 16-bit fraction is below
+    // threshold[c] (a probability scaled to 65536), otherwise alias[c]
+    uint8_t primary[INSTR_COUNT];
+    uint8_t alias[INSTR_COUNT];
+    uint32_t threshold[INSTR_COUNT];
+    uint32_t count = 0;
+
+    // Map 16 uniform random bits to a descriptor index
+    uint8_t sample(uint32_t bits16) const {
+
+        uint32_t x = bits16 * count;
+        uint32_t column = x >> 16;
+        uint32_t fraction = x & 0xFFFF;
+
+        return fraction < threshold[column] ? primary[column] : alias[column];
+
+    }
+
+};
+
+// Build the alias table for the weights of the instructions enabled in
+// instr_mask. Non-positive weights exclude an instruction; count is 0 when
+// nothing can be drawn.
+InstrSampler make_sampler(uint64_t instr_mask, const InstrWeights& weights);
+
+// Name used for an instruction class in mix files ("load", "branch", ...)
+const char* instr_class_name(InstrClass instr_class);
+
+// Read a mix file into weights. One directive per line, '#' starts a comment:
+//   default <w>          set every instruction's weight to w
+//   class <name> <w>     give a class a total weight of w, split evenly
+//                        among its instructions
+//   <mnemonic> <w>       set one instruction's weight to w
+// Directives apply in order, so later lines override earlier ones. Weights
+// are relative; they need not sum to 100. Throws std::runtime_error with
+// the file and line on a malformed or unknown entry.
+void load_mix_file(const char* path, InstrWeights& weights);
+
+struct GenConfig;
+
+// Replay the first count instructions of the stream described by config and
+// print each instruction's requested share against the share achieved
+void report_mix(const GenConfig& config, uint64_t count, std::ostream& out);
+
+#endif // MIX_H
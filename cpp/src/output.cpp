@@ -0,0 +1,599 @@
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "output.h"
+#include "corpus.h"
+#include "decoder.h"
+#include "encoders.h"
+#include "stats.h"
+
+//-------------------------------------------------
+// Block File
+//-------------------------------------------------
+
+static std::system_error io_error(const std::string& what) {
+
+    return std::system_error(errno, std::generic_category(), what);
+
+}
+
+
+
+// write() may be partial on pipes; loop until everything is taken
+static void write_all(int fd, const char* data, size_t len) {
+
+    size_t done = 0;
+
+    while (done < len) {
+
+        ssize_t n = ::write(fd, data + done, len - done);
+
+        if (n < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+
+            }
+
+            throw io_error("write failed");
+
+        }
+
+        done += static_cast<size_t>(n);
+
+    }
+
+}
+
+
+
+BlockFile::BlockFile(const char* path) : block(BLOCK_SIZE) {
+
+    if (path == nullptr || std::strcmp(path, "-") == 0) {
+
+        fd = STDOUT_FILENO;
+        owns_fd = false;
+
+    } else {
+
+        fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        owns_fd = true;
+
+        if (fd < 0) {
+
+            throw io_error(std::string("cannot open ") + path);
+
+        }
+
+    }
+
+}
+
+
+
+BlockFile::~BlockFile() {
+
+    if (owns_fd) {
+
+        ::close(fd);
+
+    }
+
+}
+
+
+
+char* BlockFile::reserve(size_t len) {
+
+    if (used + len > block.size()) {
+
+        flush();
+
+    }
+
+    char* p = block.data() + used;
+    used += len;
+    return p;
+
+}
+
+
+
+void BlockFile::append(const void* data, size_t len) {
+
+    const char* src = static_cast<const char*>(data);
+
+    while (len > 0) {
+
+        size_t chunk = std::min(len, block.size() - used);
+        std::memcpy(block.data() + used, src, chunk);
+        used += chunk;
+        src += chunk;
+        len -= chunk;
+
+        if (used == block.size()) {
+
+            flush();
+
+        }
+
+    }
+
+}
+
+
+
+void BlockFile::flush() {
+
+    StageTimer timer(Stage::OUTPUT);
+
+    write_all(fd, block.data(), used);
+    file_offset += used;
+    used = 0;
+
+}
+
+
+
+void BlockFile::write_direct(const OutputSpan* spans, size_t count) {
+
+    flush();
+    StageTimer timer(Stage::OUTPUT);
+
+    std::vector<iovec> iov(count);
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+
+        iov[i] = {const_cast<void*>(spans[i].data), spans[i].bytes};
+        total += spans[i].bytes;
+
+    }
+
+    // Calls take at most IOV_MAX spans
+    static const size_t max_spans = static_cast<size_t>(std::max(16L, ::sysconf(_SC_IOV_MAX)));
+    size_t first = 0;
+
+    while (first < count) {
+
+        ssize_t n = ::writev(fd, iov.data() + first, static_cast<int>(std::min(count - first, max_spans)));
+
+        if (n < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+
+            }
+
+            if (errno != EINVAL) {
+
+                throw io_error("writev failed");
+
+            }
+
+            // Vector rejected: the rest one span at a time
+            for (; first < count; ++first) {
+
+                write_all(fd, static_cast<const char*>(iov[first].iov_base), iov[first].iov_len);
+
+            }
+
+            break;
+
+        }
+
+        // Partial writes stop mid-vector; skip what was taken
+        size_t left = static_cast<size_t>(n);
+
+        for (; first < count && left >= iov[first].iov_len; ++first) {
+
+            left -= iov[first].iov_len;
+
+        }
+
+        if (first < count) {
+
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+            iov[first].iov_len -= left;
+
+        }
+
+    }
+
+    file_offset += total;
+
+}
+
+
+
+void BlockFile::write_at(uint64_t offset, const void* data, size_t len) {
+
+    const char* src = static_cast<const char*>(data);
+
+    while (len > 0) {
+
+        ssize_t n = ::pwrite(fd, src, len, static_cast<off_t>(offset));
+
+        if (n < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+
+            }
+
+            throw io_error("pwrite failed");
+
+        }
+
+        src += n;
+        offset += static_cast<uint64_t>(n);
+        len -= static_cast<size_t>(n);
+
+    }
+
+}
+
+
+bool BlockFile::seekable() const {
+
+    return ::lseek(fd, 0, SEEK_CUR) >= 0;
+
+}
+
+
+//-------------------------------------------------
+// Writers
+//-------------------------------------------------
+
+void OutputWriter::write_spans(const OutputSpan* spans, size_t count) {
+
+    for (size_t i = 0; i < count; ++i) {
+
+        write(static_cast<const uint32_t*>(spans[i].data), spans[i].bytes / 4);
+
+    }
+
+}
+
+
+namespace {
+
+// Raw little-endian words
+class BinWriter : public OutputWriter {
+
+public:
+
+    explicit BinWriter(const char* path) : file(path) {}
+
+    void write(const uint32_t* words, size_t n) override {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // Host order is already the file order
+        file.append(words, 4 * n);
+#else
+        for (size_t i = 0; i < n; ++i) {
+
+            uint32_t w = words[i];
+            unsigned char bytes[4] = {static_cast<unsigned char>(w), static_cast<unsigned char>(w >> 8),
+                                      static_cast<unsigned char>(w >> 16), static_cast<unsigned char>(w >> 24)};
+            std::memcpy(file.reserve(4), bytes, 4);
+
+        }
+#endif
+
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    void write_spans(const OutputSpan* spans, size_t count) override {
+
+        file.write_direct(spans, count);
+
+    }
+#endif
+
+    void finish() override { file.flush(); }
+
+private:
+
+    BlockFile file;
+
+};
+
+
+
+// $readmemh text: "xxxxxxxx\n" per word
+class ReadmemhWriter : public OutputWriter {
+
+public:
+
+    explicit ReadmemhWriter(const char* path) : file(path) {}
+
+    void write(const uint32_t* words, size_t n) override {
+
+        static const char digits[] = "0123456789abcdef";
+        StageTimer timer(Stage::TEXT, n);
+
+        for (size_t i = 0; i < n; ++i) {
+
+            char* p = file.reserve(9);
+            uint32_t w = words[i];
+
+            for (int d = 7; d >= 0; --d) {
+
+                p[d] = digits[w & 0xF];
+                w >>= 4;
+
+            }
+
+            p[8] = '\n';
+
+        }
+
+    }
+
+    void finish() override { file.flush(); }
+
+private:
+
+    BlockFile file;
+
+};
+
+
+
+// $readmemb text: 32 binary digits and "\n" per word
+class ReadmembWriter : public OutputWriter {
+
+public:
+
+    explicit ReadmembWriter(const char* path) : file(path) {}
+
+    void write(const uint32_t* words, size_t n) override {
+
+        StageTimer timer(Stage::TEXT, n);
+
+        for (size_t i = 0; i < n; ++i) {
+
+            char* p = file.reserve(33);
+            uint32_t w = words[i];
+
+            for (int b = 31; b >= 0; --b) {
+
+                p[b] = static_cast<char>('0' + (w & 1));
+                w >>= 1;
+
+            }
+
+            p[32] = '\n';
+
+        }
+
+    }
+
+    void finish() override { file.flush(); }
+
+private:
+
+    BlockFile file;
+
+};
+
+
+
+// Minimal ELF32 little-endian RISC-V executable:
+//   [0x0000] ELF header, one PT_LOAD program header
+//   [0x1000] .text (the generated words), loaded at ELF_TEXT_BASE
+//   [......] .shstrtab, then section headers (null, .text, .shstrtab)
+// The headers are rewritten in finish() once the .text size is known.
+class ElfWriter : public OutputWriter {
+
+public:
+
+    explicit ElfWriter(const char* path) : file(path) {
+
+        // The headers are patched at the end, so pipes cannot be used
+        if (!file.seekable()) {
+
+            throw io_error("ELF output needs a seekable file");
+
+        }
+
+        // Placeholder headers and padding up to the .text offset
+        char zeros[TEXT_OFFSET] = {};
+        file.append(zeros, sizeof(zeros));
+
+    }
+
+    void write(const uint32_t* words, size_t n) override {
+
+        for (size_t i = 0; i < n; ++i) {
+
+            put32(reinterpret_cast<unsigned char*>(file.reserve(4)), words[i]);
+
+        }
+
+        text_size += 4 * static_cast<uint64_t>(n);
+
+    }
+
+    void finish() override {
+
+        if (text_size > 0xFFFFFFFFull - TEXT_OFFSET - 0x100) {
+
+            errno = EFBIG;
+            throw io_error("ELF32 .text too large");
+
+        }
+
+        // Section name string table
+        static const char shstrtab[] = "\0.text\0.shstrtab";
+        uint32_t shstrtab_offset = TEXT_OFFSET + static_cast<uint32_t>(text_size);
+        uint32_t shoff = (shstrtab_offset + sizeof(shstrtab) + 3) & ~3u;
+
+        file.append(shstrtab, sizeof(shstrtab));
+        char pad[4] = {};
+        file.append(pad, shoff - shstrtab_offset - sizeof(shstrtab));
+
+        // Section headers: null, .text, .shstrtab
+        unsigned char sh[3 * 40] = {};
+        unsigned char* text_sh = sh + 40;
+        put32(text_sh + 0, 1);                                      // sh_name ".text"
+        put32(text_sh + 4, 1);                                      // SHT_PROGBITS
+        put32(text_sh + 8, 0x6);                                    // SHF_ALLOC | SHF_EXECINSTR
+        put32(text_sh + 12, ELF_TEXT_BASE);                         // sh_addr
+        put32(text_sh + 16, TEXT_OFFSET);                           // sh_offset
+        put32(text_sh + 20, static_cast<uint32_t>(text_size));      // sh_size
+        put32(text_sh + 32, 4);                                     // sh_addralign
+        unsigned char* str_sh = sh + 80;
+        put32(str_sh + 0, 7);                                       // sh_name ".shstrtab"
+        put32(str_sh + 4, 3);                                       // SHT_STRTAB
+        put32(str_sh + 16, shstrtab_offset);                        // sh_offset
+        put32(str_sh + 20, sizeof(shstrtab));                       // sh_size
+        put32(str_sh + 32, 1);                                      // sh_addralign
+        file.append(sh, sizeof(sh));
+        file.flush();
+
+        // ELF header
+        unsigned char hdr[52 + 32] = {0x7F, 'E', 'L', 'F', 1 /* ELFCLASS32 */, 1 /* little-endian */, 1 /* EV_CURRENT */};
+        put16(hdr + 16, 2);                                         // e_type ET_EXEC
+        put16(hdr + 18, 243);                                       // e_machine EM_RISCV
+        put32(hdr + 20, 1);                                         // e_version
+        put32(hdr + 24, ELF_TEXT_BASE);                             // e_entry
+        put32(hdr + 28, 52);                                        // e_phoff
+        put32(hdr + 32, shoff);                                     // e_shoff
+        put16(hdr + 40, 52);                                        // e_ehsize
+        put16(hdr + 42, 32);                                        // e_phentsize
+        put16(hdr + 44, 1);                                         // e_phnum
+        put16(hdr + 46, 40);                                        // e_shentsize
+        put16(hdr + 48, 3);                                         // e_shnum
+        put16(hdr + 50, 2);                                         // e_shstrndx
+
+        // Program header: one R+X PT_LOAD segment covering .text
+        unsigned char* ph = hdr + 52;
+        put32(ph + 0, 1);                                           // PT_LOAD
+        put32(ph + 4, TEXT_OFFSET);                                 // p_offset
+        put32(ph + 8, ELF_TEXT_BASE);                               // p_vaddr
+        put32(ph + 12, ELF_TEXT_BASE);                              // p_paddr
+        put32(ph + 16, static_cast<uint32_t>(text_size));           // p_filesz
+        put32(ph + 20, static_cast<uint32_t>(text_size));           // p_memsz
+        put32(ph + 24, 0x5);                                        // PF_R | PF_X
+        put32(ph + 28, 0x1000);                                     // p_align
+
+        file.write_at(0, hdr, sizeof(hdr));
+
+    }
+
+private:
+
+    static constexpr uint32_t TEXT_OFFSET = 0x1000;
+
+    static void put16(unsigned char* p, uint16_t v) {
+
+        p[0] = static_cast<unsigned char>(v);
+        p[1] = static_cast<unsigned char>(v >> 8);
+
+    }
+
+    static void put32(unsigned char* p, uint32_t v) {
+
+        p[0] = static_cast<unsigned char>(v);
+        p[1] = static_cast<unsigned char>(v >> 8);
+        p[2] = static_cast<unsigned char>(v >> 16);
+        p[3] = static_cast<unsigned char>(v >> 24);
+
+    }
+
+    BlockFile file;
+    uint64_t text_size = 0;
+
+};
+
+} // namespace
+
+
+//-------------------------------------------------
+// Assembly Listing
+//-------------------------------------------------
+
+void AsmWriter::write(const InstrRecord* records, size_t n) {
+
+    StageTimer timer(Stage::TEXT, n);
+
+    // Assembly, newline, up to 8 hex digits and two newlines
+    constexpr size_t LINE_MAX = MAX_ASM_LEN + 11;
+
+    for (size_t i = 0; i < n; ++i) {
+
+        const InstrRecord& rec = records[i];
+        char* start = file.reserve(LINE_MAX);
+        char* p = render_instr(rec, start);
+
+        *p++ = '\n';
+        p = std::to_chars(p, p + 8, encode_record(rec), 16).ptr;
+        p[0] = '\n';
+        p[1] = '\n';
+
+        file.release(LINE_MAX - static_cast<size_t>(p + 2 - start));
+
+    }
+
+}
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+bool parse_output_format(const char* name, OutputFormat& format) {
+
+    static const struct { const char* name; OutputFormat format; } formats[] = {
+        {"bin", OutputFormat::BIN},
+        {"hex", OutputFormat::READMEMH},
+        {"memb", OutputFormat::READMEMB},
+        {"elf", OutputFormat::ELF},
+        {"corpus", OutputFormat::CORPUS},
+    };
+
+    for (const auto& f : formats) {
+
+        if (std::strcmp(name, f.name) == 0) {
+
+            format = f.format;
+            return true;
+
+        }
+
+    }
+
+    return false;
+
+}
+
+
+
+std::unique_ptr<OutputWriter> open_output(OutputFormat format, const char* path, const GenConfig* config, uint64_t start) {
+
+    switch (format) {
+
+        case OutputFormat::BIN:      return std::make_unique<BinWriter>(path);
+        case OutputFormat::READMEMH: return std::make_unique<ReadmemhWriter>(path);
+        case OutputFormat::READMEMB: return std::make_unique<ReadmembWriter>(path);
+        case OutputFormat::ELF:      return std::make_unique<ElfWriter>(path);
+        case OutputFormat::CORPUS:   return std::make_unique<CorpusWriter>(path, config, start);
+
+    }
+
+    return nullptr;
+
+}
@@ -0,0 +1,128 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "instr_table.h"
+
+//-------------------------------------------------
+// Output Backends
+//
+// Writers take batches of encodings, format them into a large in-memory
+// block and hand full blocks to the kernel with a single write() each;
+// raw binary spans skip the block and go out with one writev().
+// I/O failures are reported with std::system_error.
+//-------------------------------------------------
+
+enum class OutputFormat : uint8_t {
+    BIN,        // raw little-endian 32-bit words
+    READMEMH,   // Verilog $readmemh: one 8-digit hex word per line
+    READMEMB,   // Verilog $readmemb: one 32-digit binary word per line
+    ELF,        // minimal ELF32 RISC-V executable with a single .text section
+    CORPUS      // columnar record corpus with a block index (see corpus.h)
+};
+
+bool parse_output_format(const char* name, OutputFormat& format);
+
+// A run of bytes handed to the kernel as one piece of a gathered write
+struct OutputSpan {
+    const void* data;
+    size_t bytes;
+};
+
+// Buffered file descriptor: appends go to a fixed block, flushed with write()
+class BlockFile {
+
+public:
+
+    static constexpr size_t BLOCK_SIZE = size_t{8} << 20;
+
+    // path == nullptr or "-" writes to stdout
+    explicit BlockFile(const char* path);
+    ~BlockFile();
+
+    BlockFile(const BlockFile&) = delete;
+    BlockFile& operator=(const BlockFile&) = delete;
+
+    // Reserve len bytes (len <= BLOCK_SIZE) at the end of the block, flushing
+    // first if they do not fit, and return a pointer to fill them
+    char* reserve(size_t len);
+
+    // Give back the unused tail of the last reserve()
+    void release(size_t len) { used -= len; }
+
+    void append(const void* data, size_t len);
+    void flush();
+
+    // Flush, then write the spans in order with writev(), bypassing the
+    // block (plain write() where the system rejects the vector)
+    void write_direct(const OutputSpan* spans, size_t count);
+
+    // Overwrite bytes already flushed to the file (requires a seekable file)
+    void write_at(uint64_t offset, const void* data, size_t len);
+
+    uint64_t bytes_written() const { return file_offset + used; }
+
+    bool seekable() const;
+
+private:
+
+    int fd;
+    bool owns_fd;
+    std::vector<char> block;
+    size_t used = 0;
+    uint64_t file_offset = 0;
+
+};
+
+class OutputWriter {
+
+public:
+
+    virtual ~OutputWriter() = default;
+
+    virtual void write(const uint32_t* words, size_t n) = 0;
+
+    // Several batches at once, each span holding whole words; formats
+    // that can pass the words through unchanged gather them into a
+    // single system call
+    virtual void write_spans(const OutputSpan* spans, size_t count);
+
+    // Flush buffered data and write any trailer; must be called once at the end
+    virtual void finish() = 0;
+
+};
+
+// Assembly listing, as the CLI's text output: each instruction's assembly,
+// its encoding in hex and a blank line. Records are rendered straight into
+// the output block, so nothing is allocated per instruction.
+class AsmWriter {
+
+public:
+
+    // path == nullptr or "-" writes to stdout
+    explicit AsmWriter(const char* path) : file(path) {}
+
+    void write(const InstrRecord* records, size_t n);
+
+    void finish() { file.flush(); }
+
+private:
+
+    BlockFile file;
+
+};
+
+// Base address of the ELF .text segment and entry point
+constexpr uint32_t ELF_TEXT_BASE = 0x80000000;
+
+struct GenConfig;
+
+// config and start, when given, are recorded by formats with a header
+std::unique_ptr<OutputWriter> open_output(OutputFormat format, const char* path, const GenConfig* config = nullptr,
+                                          uint64_t start = 0);
+
+#endif // OUTPUT_H
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "pipeline.h"
+#include "encoders.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+// Run produce(block, capacity) -> filled on the calling thread until it
+// returns 0, and consume(blocks, sizes, count) on a writer thread with
+// every block filled since its last call, in order
+template <typename T, typename Produce, typename Consume>
+void run_pipeline(const PipelineOptions& options, Produce produce, Consume consume) {
+
+    size_t depth = std::max<size_t>(options.depth, 2);
+    size_t block_size = std::max<size_t>(options.block_size, 1);
+
+    std::vector<std::vector<T>> blocks(depth, std::vector<T>(block_size));
+    std::vector<size_t> sizes(depth);
+    SpscRing<size_t> free_blocks(depth);
+    SpscRing<size_t> filled_blocks(depth);
+    RingWaiter waiter;
+    std::atomic<bool> produced{false};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+
+    for (size_t b = 0; b < depth; ++b) {
+
+        free_blocks.try_push(b);
+
+    }
+
+    std::thread writer([&]() {
+
+        std::vector<size_t> batch;
+        std::vector<const T*> data;
+        std::vector<size_t> batch_sizes;
+
+        try {
+
+            for (;;) {
+
+                waiter.wait([&]() { return !filled_blocks.empty() || produced.load(std::memory_order_acquire); });
+
+                // Read before draining: once set, every block is in the ring
+                bool last = produced.load(std::memory_order_acquire);
+                batch.clear();
+                size_t b;
+
+                while (filled_blocks.try_pop(b)) {
+
+                    batch.push_back(b);
+
+                }
+
+                if (batch.empty()) {
+
+                    if (last) {
+
+                        break;
+
+                    }
+
+                    continue;
+
+                }
+
+                data.clear();
+                batch_sizes.clear();
+
+                for (size_t k : batch) {
+
+                    data.push_back(blocks[k].data());
+                    batch_sizes.push_back(sizes[k]);
+
+                }
+
+                consume(data.data(), batch_sizes.data(), batch.size());
+
+                for (size_t k : batch) {
+
+                    free_blocks.try_push(k);
+
+                }
+
+                waiter.notify();
+
+            }
+
+        } catch (...) {
+
+            error = std::current_exception();
+            failed.store(true, std::memory_order_release);
+            waiter.notify();
+
+        }
+
+    });
+
+    std::exception_ptr producer_error;
+
+    try {
+
+        for (;;) {
+
+            waiter.wait([&]() { return !free_blocks.empty() || failed.load(std::memory_order_acquire); });
+
+            size_t b;
+
+            if (failed.load(std::memory_order_acquire) || !free_blocks.try_pop(b)) {
+
+                break;
+
+            }
+
+            size_t n = produce(blocks[b].data(), block_size);
+
+            if (n == 0) {
+
+                break;
+
+            }
+
+            sizes[b] = n;
+            filled_blocks.try_push(b);
+            waiter.notify();
+
+        }
+
+    } catch (...) {
+
+        producer_error = std::current_exception();
+
+    }
+
+    produced.store(true, std::memory_order_release);
+    waiter.notify();
+    writer.join();
+
+    if (producer_error) {
+
+        std::rethrow_exception(producer_error);
+
+    }
+
+    if (error) {
+
+        std::rethrow_exception(error);
+
+    }
+
+}
+
+} // namespace
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+void pipe_words(OutputWriter& writer, const GenConfig& config, uint64_t start, uint64_t count, unsigned threads,
+                const PipelineOptions& options, CoverageMap* coverage) {
+
+    ShardedStream stream(config);
+    stream.seek(start);
+    uint64_t done = 0;
+
+    auto produce = [&](uint32_t* block, size_t capacity) -> size_t {
+
+        size_t n = stream.generate(block, static_cast<size_t>(std::min<uint64_t>(capacity, count - done)), threads);
+        done += n;
+
+        if (coverage && n > 0) {
+
+            coverage->merge(measure_coverage(block, n, threads));
+
+        }
+
+        return n;
+
+    };
+
+    auto consume = [&](const uint32_t* const* blocks, const size_t* sizes, size_t n) {
+
+        std::vector<OutputSpan> spans(n);
+
+        for (size_t i = 0; i < n; ++i) {
+
+            spans[i] = {blocks[i], 4 * sizes[i]};
+
+        }
+
+        writer.write_spans(spans.data(), n);
+
+    };
+
+    run_pipeline<uint32_t>(options, produce, consume);
+
+}
+
+
+
+void pipe_records(AsmWriter& writer, const GenConfig& config, uint64_t start, uint64_t count,
+                  const PipelineOptions& options, CoverageMap* coverage) {
+
+    uint64_t done = 0;
+    Rng rng = stream_rng_at(config, start);
+
+    // Records are drawn up to a shard boundary at a time, each shard from
+    // its own stream, matching the words of pipe_words()
+    auto produce = [&](InstrRecord* block, size_t capacity) -> size_t {
+
+        size_t filled = 0;
+
+        while (filled < capacity && done < count) {
+
+            uint64_t index = start + done;
+            size_t n = static_cast<size_t>(std::min<uint64_t>({SHARD_SIZE - index % SHARD_SIZE, count - done, capacity - filled}));
+
+            if (index % SHARD_SIZE == 0 && done > 0) {
+
+                rng = Rng(config.rng, config.seed, index / SHARD_SIZE);
+
+            }
+
+            if (generate_records(block + filled, n, config, rng) < n) {
+
+                throw std::invalid_argument("the instruction mix is empty");
+
+            }
+
+            if (coverage) {
+
+                for (size_t i = 0; i < n; ++i) {
+
+                    coverage->sample_word(encode_record(block[filled + i]));
+
+                }
+
+            }
+
+            filled += n;
+            done += n;
+
+        }
+
+        return filled;
+
+    };
+
+    auto consume = [&](const InstrRecord* const* blocks, const size_t* sizes, size_t n) {
+
+        for (size_t i = 0; i < n; ++i) {
+
+            writer.write(blocks[i], sizes[i]);
+
+        }
+
+    };
+
+    run_pipeline<InstrRecord>(options, produce, consume);
+
+}
@@ -0,0 +1,155 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "coverage.h"
+#include "generator.h"
+#include "output.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Generation / Output Pipeline
+//
+// The calling thread generates into fixed-size blocks while a writer
+// thread formats and writes the blocks it has been handed, so the CPU
+// work and the I/O overlap. Blocks circulate between the two through a
+// pair of single-producer single-consumer rings (free and filled), so
+// memory is `depth` blocks however long the run. The writer takes every
+// filled block at once: raw binary output then goes out with one
+// writev() per batch, straight from the blocks.
+//-------------------------------------------------
+
+// Bounded lock-free queue for exactly one producer and one consumer
+template <typename T>
+class SpscRing {
+
+public:
+
+    explicit SpscRing(size_t capacity) : slots(capacity + 1) {}
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+    // Producer side; false when full
+    bool try_push(const T& value) {
+
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = t + 1 == slots.size() ? 0 : t + 1;
+
+        if (next == head.load(std::memory_order_acquire)) {
+
+            return false;
+
+        }
+
+        slots[t] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+
+    }
+
+    // Consumer side; false when empty
+    bool try_pop(T& value) {
+
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (h == tail.load(std::memory_order_acquire)) {
+
+            return false;
+
+        }
+
+        value = slots[h];
+        head.store(h + 1 == slots.size() ? 0 : h + 1, std::memory_order_release);
+        return true;
+
+    }
+
+private:
+
+    // One slot stays empty to tell full from empty
+    std::vector<T> slots;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+};
+
+// Where a ring's other side sleeps when there is nothing to do. Waiting
+// spins briefly, then parks on a condition variable; notify() only takes
+// the lock when someone is parked.
+class RingWaiter {
+
+public:
+
+    template <typename Ready>
+    void wait(Ready ready) {
+
+        for (int spin = 0; spin < 64; ++spin) {
+
+            if (ready()) {
+
+                return;
+
+            }
+
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, ready);
+        sleepers.fetch_sub(1);
+
+    }
+
+    // Call after the state a waiter checks has changed
+    void notify() {
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+
+        }
+
+    }
+
+private:
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<int> sleepers{0};
+
+};
+
+struct PipelineOptions {
+
+    // Blocks in flight between the generator and the writer; 2 is plain
+    // double buffering
+    size_t depth = 4;
+
+    // Instructions per block
+    size_t block_size = 4 * SHARD_SIZE;
+
+};
+
+// Write instructions [start, start + count) of config's stream to writer,
+// generating with up to `threads` workers; the words are those of
+// ShardedStream. Coverage of the words is merged into coverage when
+// given. Does not call writer.finish(). An exception on either side stops
+// both and is rethrown here.
+void pipe_words(OutputWriter& writer, const GenConfig& config, uint64_t start, uint64_t count, unsigned threads,
+                const PipelineOptions& options = {}, CoverageMap* coverage = nullptr);
+
+// As above for the assembly listing, which is formatted on the writer thread
+void pipe_records(AsmWriter& writer, const GenConfig& config, uint64_t start, uint64_t count,
+                  const PipelineOptions& options = {}, CoverageMap* coverage = nullptr);
+
+#endif // PIPELINE_H
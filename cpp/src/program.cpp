@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "program.h"
+#include "encoders.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+// Largest forward distance, in body instructions, that still fits the
+// offset field when every body instruction between may expand to two words
+constexpr size_t BRANCH_REACH = 511;       // 13-bit byte offset
+constexpr size_t JAL_REACH = 131071;       // 21-bit byte offset
+constexpr size_t JALR_REACH = 255;         // 12-bit offset from the auipc
+
+// Label of a forward target 1..reach instructions ahead, capped at the halt
+// loop, derived from the drawn offset
+static size_t forward_target(size_t index, int32_t imm, size_t reach, size_t body_count) {
+
+    reach = std::max<size_t>(1, std::min(reach, body_count - index));
+    return index + 1 + (static_cast<uint32_t>(imm) >> 1) % reach;
+
+}
+
+
+
+Program build_program(const GenConfig& config, size_t body_count, size_t jump_reach, uint32_t text_base) {
+
+    GenConfig cfg = config;
+
+    if (cfg.regs.base_regs == 0) {
+
+        cfg.regs.base_regs = DEFAULT_PROGRAM_BASE_REGS;
+
+    }
+
+    if (cfg.regs.base_regs & 1u) {
+
+        throw std::invalid_argument("x0 cannot be a load/store base register");
+
+    }
+
+    GenTables tables = make_gen_tables(cfg);
+    uint32_t base_regs = cfg.regs.base_regs;
+    uint32_t writable = tables.regs.rd_mask & ~base_regs & ~1u;
+
+    if (tables.sampler.count == 0) {
+
+        throw std::invalid_argument("the instruction mix is empty");
+
+    }
+
+    if (writable == 0) {
+
+        throw std::invalid_argument("no register is left for the program to write");
+
+    }
+
+    // Body records, shard by shard as in the plain stream
+    std::vector<InstrRecord> body(body_count);
+
+    for (size_t done = 0; done < body_count; done += SHARD_SIZE) {
+
+        Rng rng(cfg.rng, cfg.seed, done / SHARD_SIZE);
+        generate_records(body.data() + done, std::min(SHARD_SIZE, body_count - done), cfg, rng);
+
+    }
+
+    // Label table: output index of every body instruction, and of the halt
+    // loop at pos[body_count]
+    size_t prologue = 31 + static_cast<size_t>(__builtin_popcount(base_regs));
+    std::vector<uint32_t> pos(body_count + 1);
+    uint64_t next = prologue;
+
+    for (size_t j = 0; j < body_count; ++j) {
+
+        pos[j] = static_cast<uint32_t>(next);
+        next += body[j].id == ID_JALR ? 2 : 1;
+
+    }
+
+    pos[body_count] = static_cast<uint32_t>(next);
+
+    uint64_t total = next + 1;
+    uint64_t sandbox = (text_base + 4 * total + SANDBOX_WINDOW - 1) / SANDBOX_WINDOW * SANDBOX_WINDOW;
+    uint64_t sandbox_size = uint64_t{SANDBOX_WINDOW} * static_cast<uint64_t>(__builtin_popcount(base_regs));
+
+    if (sandbox + sandbox_size > (uint64_t{1} << 32)) {
+
+        throw std::invalid_argument("the program does not fit in the 32-bit address space");
+
+    }
+
+    Program program;
+    program.records.reserve(total);
+    program.sandbox_base = static_cast<uint32_t>(sandbox);
+    program.sandbox_size = static_cast<uint32_t>(sandbox_size);
+    program.body_start = prologue;
+    program.halt_index = pos[body_count];
+
+    std::vector<InstrRecord>& out = program.records;
+
+    // Prologue: base registers to the middle of their sandbox window
+    // (lui + addi), everything else to zero
+    uint32_t window = 0;
+
+    for (uint8_t r = 1; r < 32; ++r) {
+
+        if ((base_regs >> r) & 1u) {
+
+            uint32_t value = program.sandbox_base + window++ * SANDBOX_WINDOW + SANDBOX_WINDOW / 2;
+            uint32_t hi = (value + 0x800) >> 12;
+            int32_t lo = static_cast<int32_t>(value - (hi << 12));
+
+            out.push_back({ID_LUI, r, 0, 0, static_cast<int32_t>(hi & 0xFFFFF)});
+            out.push_back({ID_ADDI, r, r, 0, lo});
+
+        } else {
+
+            out.push_back({ID_ADDI, r, 0, 0, 0});
+
+        }
+
+    }
+
+    // Body: every target is a later label, already in the table
+    uint8_t scratch = static_cast<uint8_t>(__builtin_ctz(writable));
+
+    for (size_t j = 0; j < body_count; ++j) {
+
+        InstrRecord rec = body[j];
+        const InstrDesc& desc = instr_table[rec.id];
+
+        switch (desc.instr_class) {
+
+            case InstrClass::BRANCH:
+                rec.imm = 4 * static_cast<int32_t>(pos[forward_target(j, rec.imm, std::min(jump_reach, BRANCH_REACH), body_count)] - pos[j]);
+                break;
+
+            case InstrClass::JUMP:
+                rec.imm = 4 * static_cast<int32_t>(pos[forward_target(j, rec.imm, std::min(jump_reach, JAL_REACH), body_count)] - pos[j]);
+                break;
+
+            case InstrClass::JUMP_REG: {
+                // The address comes from an auipc right before, into rs1 when
+                // the program may write it
+                uint8_t t = ((writable >> rec.rs1) & 1u) ? rec.rs1 : scratch;
+
+                out.push_back({ID_AUIPC, t, 0, 0, 0});
+                rec.rs1 = t;
+                rec.imm = 4 * static_cast<int32_t>(pos[forward_target(j, rec.imm, std::min(jump_reach, JALR_REACH), body_count)] - pos[j]);
+                break;
+            }
+
+            case InstrClass::LOAD:
+            case InstrClass::STORE:
+                // Natural alignment for the access size (funct3[1:0] = log2)
+                rec.imm &= ~((1 << (desc.funct3 & 0x3)) - 1);
+                break;
+
+            default:
+                break;
+
+        }
+
+        out.push_back(rec);
+
+    }
+
+    // Epilogue: halt loop
+    out.push_back({ID_JAL, 0, 0, 0, 0});
+
+    return program;
+
+}
+
+
+
+std::vector<uint32_t> encode_program(const Program& program) {
+
+    std::vector<uint32_t> words(program.records.size());
+
+    for (size_t i = 0; i < words.size(); ++i) {
+
+        const InstrRecord& rec = program.records[i];
+        words[i] = encode_record(rec);
+
+    }
+
+    return words;
+
+}
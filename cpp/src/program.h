@@ -0,0 +1,65 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "generator.h"
+#include "output.h"
+
+//-------------------------------------------------
+// Executable Program Mode
+//
+// Turns a random stream into a self-contained program that runs to
+// completion on a core or the ISS:
+//   - a prologue zeroes every register and points each load/store base
+//     register at its own 4 KiB window of a data sandbox placed after .text
+//   - the body is the drawn stream with every branch, jal and jalr retargeted
+//     to a later instruction boundary, so control only ever moves forward
+//   - a jalr becomes "auipc t, 0; jalr rd, off(t)" so its target is exact
+//   - loads and stores keep their base register and get an aligned offset
+//   - the epilogue is "jal x0, 0", the usual halt loop
+//
+// Targets are labels (body indices) resolved against a position table in
+// the same pass that emits the body, so building is O(n).
+//-------------------------------------------------
+
+// Load/store base registers used when the config does not name any (sp, gp)
+constexpr uint32_t DEFAULT_PROGRAM_BASE_REGS = (uint32_t{1} << 2) | (uint32_t{1} << 3);
+
+// Default longest forward skip, in body instructions, of a branch or jump.
+// Short skips keep most of the body on the executed path.
+constexpr size_t DEFAULT_JUMP_REACH = 16;
+
+// Size of the sandbox window behind each base register; the register points
+// at its middle so every 12-bit offset stays inside
+constexpr uint32_t SANDBOX_WINDOW = 4096;
+
+struct Program {
+
+    std::vector<InstrRecord> records;
+
+    // Data sandbox: one SANDBOX_WINDOW per base register, in register order
+    uint32_t sandbox_base;
+    uint32_t sandbox_size;
+
+    // Index of the first body instruction and of the halt loop
+    size_t body_start;
+    size_t halt_index;
+
+};
+
+// Build a program with body_count random instructions drawn from config
+// (shard k of the body uses Rng(config.rng, config.seed, k), as the plain
+// stream does) for loading at text_base. Branches and jumps skip ahead by
+// 1..jump_reach instructions, further limited by their offset fields.
+// Throws std::invalid_argument if the config leaves no writable register or
+// no instruction to draw.
+Program build_program(const GenConfig& config, size_t body_count, size_t jump_reach = DEFAULT_JUMP_REACH,
+                      uint32_t text_base = ELF_TEXT_BASE);
+
+// Machine words of a program
+std::vector<uint32_t> encode_program(const Program& program);
+
+#endif // PROGRAM_H
@@ -0,0 +1,70 @@
+#include "reg_pool.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+RegSet make_reg_set(uint32_t mask) {
+
+    RegSet set;
+    set.mask = mask;
+
+    for (uint32_t r = 0; r < 32; ++r) {
+
+        if ((mask >> r) & 1) {
+
+            set.rank[r] = static_cast<uint8_t>(set.count);
+            set.reg[set.count++] = static_cast<uint8_t>(r);
+
+        }
+
+    }
+
+    return set;
+
+}
+
+
+
+RegPool make_reg_pool(const RegConstraints& constraints) {
+
+    RegPool pool;
+
+    pool.active = constraints.no_x0_rd || constraints.base_regs != 0 || constraints.rd_ne_rs1 ||
+                  (constraints.hot_regs != 0 && constraints.hot_percent > 0);
+
+    // Destinations: everything except x0 (if requested) and reserved bases
+    pool.rd_mask = ~constraints.base_regs;
+
+    if (constraints.no_x0_rd) {
+
+        pool.rd_mask &= ~1u;
+
+    }
+
+    pool.base_mask = constraints.base_regs != 0 ? constraints.base_regs : ~0u;
+    pool.src_mask = ~0u;
+    pool.hot_mask = constraints.hot_regs;
+    pool.hot_threshold = constraints.hot_percent >= 100 ? 256 : constraints.hot_percent * 256 / 100;
+    pool.rd_ne_rs1 = constraints.rd_ne_rs1;
+
+    if (pool.rd_mask == 0) {
+
+        pool.rd_mask = ~0u;
+
+    }
+
+    if (pool.hot_mask == 0) {
+
+        pool.hot_threshold = 0;
+
+    }
+
+    pool.rd_set = make_reg_set(pool.rd_mask);
+    pool.src_set = make_reg_set(pool.src_mask);
+    pool.base_set = make_reg_set(pool.base_mask);
+    pool.hot_set = make_reg_set(pool.hot_mask);
+
+    return pool;
+
+}
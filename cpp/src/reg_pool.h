@@ -0,0 +1,95 @@
+#ifndef REG_POOL_H
+#define REG_POOL_H
+
+#include <cstdint>
+
+#include "instr_table.h"
+
+//-------------------------------------------------
+// Constrained Register Pools
+//
+// Register sets are 32-bit masks (bit i = xi). make_reg_pool() lists the
+// registers of each role's mask in a table, and a register is drawn by
+// scaling random bits onto the table's length and indexing it: a multiply
+// and a load for any mask, with no popcount or bit scan per draw.
+//-------------------------------------------------
+
+struct RegConstraints {
+
+    // Never use x0 as a destination
+    bool no_x0_rd = false;
+
+    // Base registers reserved for load/store addressing. When non-empty,
+    // loads and stores take rs1 from this set and no instruction writes it.
+    uint32_t base_regs = 0;
+
+    // Force rd != rs1 on instructions that have both
+    bool rd_ne_rs1 = false;
+
+    // With probability hot_percent / 100, each source operand comes from
+    // this subset instead, creating short read-after-write dependencies
+    uint32_t hot_regs = 0;
+    uint32_t hot_percent = 0;
+
+};
+
+// Registers of one mask in ascending order
+struct RegSet {
+
+    uint32_t mask = 0;
+    uint32_t count = 0;
+
+    // reg[k] = k-th register of the set; rank[r] = k for each register r in it
+    uint8_t reg[32] = {};
+    uint8_t rank[32] = {};
+
+};
+
+RegSet make_reg_set(uint32_t mask);
+
+// Per-role masks derived from RegConstraints, with their register tables
+struct RegPool {
+
+    // False when there are no constraints; records keep their raw fields
+    bool active = false;
+
+    uint32_t rd_mask = ~0u;
+    uint32_t src_mask = ~0u;
+    uint32_t base_mask = ~0u;
+    uint32_t hot_mask = 0;
+
+    RegSet rd_set;
+    RegSet src_set;
+    RegSet base_set;
+    RegSet hot_set;
+
+    // Hot draw when the 8-bit roll is below this (hot_percent scaled to 256)
+    uint32_t hot_threshold = 0;
+
+    bool rd_ne_rs1 = false;
+
+};
+
+// Empty role masks (e.g. every register excluded) fall back to all registers
+RegPool make_reg_pool(const RegConstraints& constraints);
+
+// Uniformly pick a register from a non-empty set using 16 random bits
+inline uint8_t select_register(const RegSet& set, uint32_t bits16) {
+
+    return set.reg[(bits16 * set.count) >> 16];
+
+}
+
+// As select_register() on the set without register `excluded`, unless that
+// would leave it empty. The k-th register of the smaller set is reg[k]
+// below excluded's rank and reg[k + 1] from it on.
+inline uint8_t select_register_except(const RegSet& set, uint32_t excluded, uint32_t bits16) {
+
+    uint32_t skip = ((set.mask >> excluded) & 1) & (set.count > 1);
+    uint32_t k = (bits16 * (set.count - skip)) >> 16;
+
+    return set.reg[k + (skip & (k >= set.rank[excluded]))];
+
+}
+
+#endif // REG_POOL_H
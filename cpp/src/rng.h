@@ -0,0 +1,225 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstdint>
+
+//-------------------------------------------------
+// Pseudo-Random Number Generators
+//
+// All generator state is explicit: every engine is an object owned by its
+// caller (one per thread or shard), seeded from a 64-bit seed and a stream
+// id, and produces one 64-bit word per call to next().
+//-------------------------------------------------
+
+enum class RngKind : uint8_t { XOSHIRO, PHILOX };
+
+// SplitMix64, used to expand a 64-bit seed into engine state
+inline uint64_t splitmix64(uint64_t& state) {
+
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+
+}
+
+
+
+// xoshiro256** (Blackman & Vigna): fast sequential engine with 2^256-1 period.
+// Each stream id hashes to its own starting state, so stream k can be created
+// in constant time; jump() is available to split one stream further.
+class Xoshiro256ss {
+
+public:
+
+    explicit Xoshiro256ss(uint64_t seed = 0, uint64_t stream = 0) {
+
+        uint64_t stream_hash = stream;
+        uint64_t sm = seed ^ splitmix64(stream_hash);
+
+        for (uint64_t& word : s) {
+
+            word = splitmix64(sm);
+
+        }
+
+    }
+
+    uint64_t next() {
+
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return result;
+
+    }
+
+    // Advance the state by 2^128 draws
+    void jump() {
+
+        static constexpr uint64_t JUMP[] = {0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull,
+                                            0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull};
+
+        uint64_t t[4] = {0, 0, 0, 0};
+
+        for (uint64_t mask : JUMP) {
+
+            for (int b = 0; b < 64; ++b) {
+
+                if (mask & (uint64_t{1} << b)) {
+
+                    t[0] ^= s[0];
+                    t[1] ^= s[1];
+                    t[2] ^= s[2];
+                    t[3] ^= s[3];
+
+                }
+
+                next();
+
+            }
+
+        }
+
+        s[0] = t[0];
+        s[1] = t[1];
+        s[2] = t[2];
+        s[3] = t[3];
+
+    }
+
+private:
+
+    static uint64_t rotl(uint64_t x, int k) {
+
+        return (x << k) | (x >> (64 - k));
+
+    }
+
+    uint64_t s[4];
+
+};
+
+
+
+// Philox4x32-10 (Salmon et al.): counter-based engine. Word k of a stream is
+// a pure function of (seed, stream, k), so any position can be computed
+// directly with at(k) without replaying the words before it.
+class Philox4x32 {
+
+public:
+
+    explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+        : key0(static_cast<uint32_t>(seed)), key1(static_cast<uint32_t>(seed >> 32)), stream(stream) {}
+
+    uint64_t next() {
+
+        return at(position++);
+
+    }
+
+    // Word at absolute position k of this stream
+    uint64_t at(uint64_t k) const {
+
+        // Each 128-bit block yields two 64-bit words
+        uint32_t ctr[4] = {static_cast<uint32_t>(k >> 1), static_cast<uint32_t>(k >> 33),
+                           static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+        uint32_t k0 = key0;
+        uint32_t k1 = key1;
+
+        for (int round = 0; round < 10; ++round) {
+
+            uint64_t p0 = uint64_t{0xD2511F53} * ctr[0];
+            uint64_t p1 = uint64_t{0xCD9E8D57} * ctr[2];
+
+            uint32_t c1 = static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ k0;
+            uint32_t c3 = static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ k1;
+
+            ctr[0] = c1;
+            ctr[1] = static_cast<uint32_t>(p1);
+            ctr[2] = c3;
+            ctr[3] = static_cast<uint32_t>(p0);
+
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+
+        }
+
+        return (k & 1) ? (uint64_t{ctr[3]} << 32 | ctr[2]) : (uint64_t{ctr[1]} << 32 | ctr[0]);
+
+    }
+
+    // Reposition the stream so the next draw returns word k
+    void seek(uint64_t k) {
+
+        position = k;
+
+    }
+
+private:
+
+    uint32_t key0;
+    uint32_t key1;
+    uint64_t stream;
+    uint64_t position = 0;
+
+};
+
+
+
+// Destination registers of a stream's most recent instructions, used by
+// hazard shaping (see hazard.h). It travels with the stream's engine, so a
+// stream continued across batches keeps its history.
+struct Scoreboard {
+
+    // Destination of each of the last 8 instructions, most recent in the
+    // low byte; 0 where an instruction wrote no register
+    uint64_t dest = 0;
+
+    // The most recent instruction was a load with a destination
+    bool last_load = false;
+
+};
+
+
+
+// Engine selected at runtime. Batch loops dispatch on kind() once per batch
+// and then run against the concrete engine, so the per-draw cost is that of
+// the engine itself.
+class Rng {
+
+public:
+
+    Rng(RngKind kind, uint64_t seed, uint64_t stream = 0)
+        : engine_kind(kind),
+          xoshiro_engine(kind == RngKind::XOSHIRO ? Xoshiro256ss(seed, stream) : Xoshiro256ss()),
+          philox_engine(seed, stream) {}
+
+    uint64_t next() {
+
+        return engine_kind == RngKind::XOSHIRO ? xoshiro_engine.next() : philox_engine.next();
+
+    }
+
+    RngKind kind() const { return engine_kind; }
+    Xoshiro256ss& xoshiro() { return xoshiro_engine; }
+    Philox4x32& philox() { return philox_engine; }
+    Scoreboard& scoreboard() { return board; }
+
+private:
+
+    RngKind engine_kind;
+    Xoshiro256ss xoshiro_engine;
+    Philox4x32 philox_engine;
+    Scoreboard board;
+
+};
+
+#endif // RNG_H
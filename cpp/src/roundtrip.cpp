@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "roundtrip.h"
+#include "decoder.h"
+#include "encoders.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+// Mismatches printed before the rest are only counted
+constexpr uint64_t MAX_REPORTED = 8;
+
+class Checker {
+
+public:
+
+    explicit Checker(std::ostream& log) : log(log) {}
+
+    // Encode rec, decode it again and compare; rec must be canonical
+    bool check(const InstrRecord& rec) {
+
+        uint32_t word = encode_instr(instr_table[rec.id], rec.rd, rec.rs1, rec.rs2, rec.imm);
+        InstrRecord back;
+
+        // The specialised encoder must agree with the table-driven one, and
+        // InstrRecord has no padding, so the record compare is one 64-bit compare
+        if (encode_record(rec) == word && decode_instr(word, back) && std::memcmp(&back, &rec, sizeof(rec)) == 0) {
+
+            return true;
+
+        }
+
+        report(rec, word);
+        return false;
+
+    }
+
+    uint64_t mismatches() const { return failures.load(); }
+
+private:
+
+    void report(const InstrRecord& rec, uint32_t word) {
+
+        if (failures.fetch_add(1) >= MAX_REPORTED) {
+
+            return;
+
+        }
+
+        char hex[16];
+        std::snprintf(hex, sizeof(hex), "0x%08x", word);
+
+        std::lock_guard<std::mutex> lock(log_mutex);
+        log << "  mismatch: " << format_instr(rec) << " -> " << hex << " -> " << disassemble(word) << "\n";
+
+    }
+
+    std::ostream& log;
+    std::mutex log_mutex;
+    std::atomic<uint64_t> failures{0};
+
+};
+
+// Run worker(t) on `threads` threads, the calling thread included
+template <typename Worker>
+void run_workers(unsigned threads, Worker worker) {
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        pool.emplace_back(worker);
+
+    }
+
+    worker();
+
+    for (std::thread& th : pool) {
+
+        th.join();
+
+    }
+
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+}
+
+// Immediates an instruction's encoding can hold: the whole field of its
+// format, independent of the range the generator draws from
+struct ImmField {
+    int32_t min;
+    int32_t max;
+    int32_t step;
+};
+
+ImmField imm_field(const InstrDesc& desc) {
+
+    switch (desc.format) {
+
+        case Format::R: return {0, 0, 1};
+        case Format::I: return desc.instr_class == InstrClass::SHIFT ? ImmField{0, 31, 1} : ImmField{-(1 << 11), (1 << 11) - 1, 1};
+        case Format::S: return {-(1 << 11), (1 << 11) - 1, 1};
+        case Format::B: return {-(1 << 12), (1 << 12) - 2, 2};
+        case Format::U: return {0, (1 << 20) - 1, 1};
+        case Format::J: return {-(1 << 20), (1 << 20) - 2, 2};
+
+    }
+
+    return {0, 0, 1};
+
+}
+
+void print_summary(const char* name, const RoundTripStats& stats, std::ostream& log) {
+
+    log << name << ": " << stats.checked << " instructions, " << stats.mismatches << " mismatches ("
+        << stats.seconds << " s, " << stats.checked / stats.seconds / 1e6 << " M instr/s)\n";
+
+}
+
+} // namespace
+
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+RoundTripStats fuzz_round_trip(const GenConfig& config, uint64_t count, unsigned threads, std::ostream& log) {
+
+    auto start = std::chrono::steady_clock::now();
+    Checker checker(log);
+    size_t shard_count = static_cast<size_t>((count + SHARD_SIZE - 1) / SHARD_SIZE);
+    std::atomic<size_t> next_shard{0};
+    std::atomic<uint64_t> checked{0};
+
+    // Each worker regenerates whole shards of the stream and checks them
+    auto worker = [&]() {
+
+        std::vector<InstrRecord> records(SHARD_SIZE);
+        uint64_t local_checked = 0;
+
+        for (size_t s = next_shard.fetch_add(1, std::memory_order_relaxed); s < shard_count;
+             s = next_shard.fetch_add(1, std::memory_order_relaxed)) {
+
+            size_t len = static_cast<size_t>(std::min<uint64_t>(SHARD_SIZE, count - s * SHARD_SIZE));
+            Rng rng(config.rng, config.seed, s);
+            size_t n = generate_records(records.data(), len, config, rng);
+
+            for (size_t i = 0; i < n; ++i) {
+
+                checker.check(canonical_record(records[i]));
+
+            }
+
+            local_checked += n;
+
+        }
+
+        checked.fetch_add(local_checked, std::memory_order_relaxed);
+
+    };
+
+    run_workers(static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(resolve_threads(threads), shard_count))), worker);
+
+    RoundTripStats stats;
+    stats.checked = checked.load();
+    stats.mismatches = checker.mismatches();
+    stats.seconds = seconds_since(start);
+    print_summary("round-trip fuzz", stats, log);
+    return stats;
+
+}
+
+
+
+RoundTripStats sweep_round_trip(unsigned threads, std::ostream& log) {
+
+    // One work unit is a run of immediates of one instruction, crossed with
+    // every register combination the format encodes
+    struct Unit {
+        uint8_t id;
+        int32_t imm_first;
+        uint32_t imm_count;
+    };
+
+    constexpr uint32_t IMMS_PER_UNIT = 256;
+    std::vector<Unit> units;
+
+    for (uint32_t id = 0; id < INSTR_COUNT; ++id) {
+
+        ImmField field = imm_field(instr_table[id]);
+        uint32_t imm_total = static_cast<uint32_t>((static_cast<int64_t>(field.max) - field.min) / field.step + 1);
+
+        for (uint32_t k = 0; k < imm_total; k += IMMS_PER_UNIT) {
+
+            units.push_back({static_cast<uint8_t>(id), field.min + static_cast<int32_t>(k) * field.step,
+                             std::min(IMMS_PER_UNIT, imm_total - k)});
+
+        }
+
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Checker checker(log);
+    std::atomic<size_t> next_unit{0};
+    std::atomic<uint64_t> checked{0};
+
+    auto worker = [&]() {
+
+        uint64_t local_checked = 0;
+
+        for (size_t u = next_unit.fetch_add(1, std::memory_order_relaxed); u < units.size();
+             u = next_unit.fetch_add(1, std::memory_order_relaxed)) {
+
+            const Unit& unit = units[u];
+            const InstrDesc& desc = instr_table[unit.id];
+            int32_t step = imm_field(desc).step;
+
+            // Register fields the format encodes: bit 0 rd, bit 1 rs1, bit 2 rs2
+            uint32_t fields = 0;
+
+            switch (desc.format) {
+
+                case Format::R: fields = 0x7; break;
+                case Format::I: fields = 0x3; break;
+                case Format::S: fields = 0x6; break;
+                case Format::B: fields = 0x6; break;
+                case Format::U: fields = 0x1; break;
+                case Format::J: fields = 0x1; break;
+
+            }
+
+            uint32_t rd_count = (fields & 0x1) ? 32 : 1;
+            uint32_t rs1_count = (fields & 0x2) ? 32 : 1;
+            uint32_t rs2_count = (fields & 0x4) ? 32 : 1;
+
+            for (uint32_t k = 0; k < unit.imm_count; ++k) {
+
+                int32_t imm = unit.imm_first + static_cast<int32_t>(k) * step;
+
+                for (uint32_t rd = 0; rd < rd_count; ++rd) {
+
+                    for (uint32_t rs1 = 0; rs1 < rs1_count; ++rs1) {
+
+                        for (uint32_t rs2 = 0; rs2 < rs2_count; ++rs2) {
+
+                            InstrRecord rec = {unit.id, static_cast<uint8_t>(rd), static_cast<uint8_t>(rs1),
+                                               static_cast<uint8_t>(rs2), imm};
+                            checker.check(rec);
+
+                        }
+
+                    }
+
+                }
+
+                local_checked += rd_count * rs1_count * rs2_count;
+
+            }
+
+        }
+
+        checked.fetch_add(local_checked, std::memory_order_relaxed);
+
+    };
+
+    run_workers(resolve_threads(threads), worker);
+
+    RoundTripStats stats;
+    stats.checked = checked.load();
+    stats.mismatches = checker.mismatches();
+    stats.seconds = seconds_since(start);
+    print_summary("round-trip sweep", stats, log);
+    return stats;
+
+}
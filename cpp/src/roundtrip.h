@@ -0,0 +1,36 @@
+#ifndef ROUNDTRIP_H
+#define ROUNDTRIP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "generator.h"
+
+//-------------------------------------------------
+// Encode/Decode Round-Trip Verification
+//
+// Every check encodes a record with encode_instr(), requires the same word
+// from the specialised encode_record(), decodes the word with the table
+// decoder and requires the original record back (see canonical_record()). Work is split across threads; mismatches are
+// reported to the log with the expected and decoded assembly.
+//-------------------------------------------------
+
+struct RoundTripStats {
+    uint64_t checked = 0;
+    uint64_t mismatches = 0;
+    double seconds = 0;
+};
+
+// Check the first `count` records of config's stream, i.e. the instructions
+// --seed/--rng with the same config would emit
+RoundTripStats fuzz_round_trip(const GenConfig& config, uint64_t count, unsigned threads, std::ostream& log);
+
+// Check every instruction with every register combination its format
+// encodes and every value of its immediate field, whatever range the
+// generator draws from: 12 bits for I and S, a 5-bit shamt for shifts,
+// 13 bits for B, 20 for U and 21 for J (even offsets only for branches
+// and jumps), i.e. the complete legal encoding space of the table
+RoundTripStats sweep_round_trip(unsigned threads, std::ostream& log);
+
+#endif // ROUNDTRIP_H
@@ -0,0 +1,793 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "serve.h"
+#include "pipeline.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+std::system_error io_error(const std::string& what) {
+
+    return std::system_error(errno, std::generic_category(), what);
+
+}
+
+sockaddr_un socket_address(const char* path) {
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (std::strlen(path) >= sizeof(addr.sun_path)) {
+
+        throw std::invalid_argument(std::string(path) + ": socket path too long");
+
+    }
+
+    std::strcpy(addr.sun_path, path);
+    return addr;
+
+}
+
+void send_all(int fd, const void* data, size_t len) {
+
+    const char* p = static_cast<const char*>(data);
+
+    while (len > 0) {
+
+        ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+
+        if (n < 0) {
+
+            if (errno == EINTR) {
+
+                continue;
+
+            }
+
+            throw io_error("send failed");
+
+        }
+
+        p += n;
+        len -= static_cast<size_t>(n);
+
+    }
+
+}
+
+void recv_all(int fd, void* data, size_t len) {
+
+    char* p = static_cast<char*>(data);
+
+    while (len > 0) {
+
+        ssize_t n = ::recv(fd, p, len, 0);
+
+        if (n < 0 && errno == EINTR) {
+
+            continue;
+
+        }
+
+        if (n <= 0) {
+
+            if (n == 0) {
+
+                errno = ECONNRESET;
+
+            }
+
+            throw io_error("recv failed");
+
+        }
+
+        p += n;
+        len -= static_cast<size_t>(n);
+
+    }
+
+}
+
+uint64_t get_le(const unsigned char* p, int bytes) {
+
+    uint64_t value = 0;
+
+    for (int b = 0; b < bytes; ++b) {
+
+        value |= static_cast<uint64_t>(p[b]) << (8 * b);
+
+    }
+
+    return value;
+
+}
+
+void put_le(unsigned char* p, uint64_t value, int bytes) {
+
+    for (int b = 0; b < bytes; ++b) {
+
+        p[b] = static_cast<unsigned char>(value >> (8 * b));
+
+    }
+
+}
+
+// Words travel little-endian whatever the host order
+void to_wire_order(uint32_t* words, size_t n) {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < n; ++i) {
+
+        words[i] = __builtin_bswap32(words[i]);
+
+    }
+#else
+    (void)words;
+    (void)n;
+#endif
+
+}
+
+// Words of one stream from a position on, generated ahead of demand by a
+// thread of its own into a ring of blocks
+class Prefetcher {
+
+public:
+
+    Prefetcher(const GenConfig& config, uint64_t start, const ServeOptions& options)
+        : block_words(std::max<size_t>(options.block_words, 1)), blocks(std::max<size_t>(options.depth, 2)),
+          free_blocks(blocks.size()), filled_blocks(blocks.size()), pos(start) {
+
+        for (size_t b = 0; b < blocks.size(); ++b) {
+
+            blocks[b].resize(block_words);
+            free_blocks.try_push(b);
+
+        }
+
+        producer = std::thread([this, config, start]() {
+
+            ShardedStream stream(config);
+            stream.seek(start);
+
+            for (;;) {
+
+                waiter.wait([&]() { return !free_blocks.empty() || stopping.load(std::memory_order_acquire); });
+
+                size_t b;
+
+                if (stopping.load(std::memory_order_acquire) || !free_blocks.try_pop(b)) {
+
+                    return;
+
+                }
+
+                stream.generate(blocks[b].data(), block_words);
+                filled_blocks.try_push(b);
+                waiter.notify();
+
+            }
+
+        });
+
+    }
+
+    ~Prefetcher() {
+
+        stopping.store(true, std::memory_order_release);
+        waiter.notify();
+        producer.join();
+
+    }
+
+    // Index of the next word take() returns
+    uint64_t position() const { return pos; }
+
+    void take(uint32_t* out, size_t n) {
+
+        while (n > 0) {
+
+            if (current == NONE) {
+
+                waiter.wait([&]() { return !filled_blocks.empty(); });
+                filled_blocks.try_pop(current);
+                offset = 0;
+
+            }
+
+            size_t m = std::min(n, block_words - offset);
+            std::memcpy(out, blocks[current].data() + offset, 4 * m);
+            out += m;
+            n -= m;
+            offset += m;
+            pos += m;
+
+            // Drained blocks go back to the generator
+            if (offset == block_words) {
+
+                free_blocks.try_push(current);
+                current = NONE;
+                waiter.notify();
+
+            }
+
+        }
+
+    }
+
+private:
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    size_t block_words;
+    std::vector<std::vector<uint32_t>> blocks;
+    SpscRing<size_t> free_blocks;
+    SpscRing<size_t> filled_blocks;
+    RingWaiter waiter;
+    std::atomic<bool> stopping{false};
+    std::thread producer;
+    size_t current = NONE;
+    size_t offset = 0;
+    uint64_t pos;
+
+};
+
+// Bound on one batched reply, so queued requests cannot grow it unchecked
+constexpr size_t MAX_REPLY_WORDS = size_t{1} << 20;
+
+// Requests read from the socket at once
+constexpr size_t REQUEST_BATCH = 64;
+
+} // namespace
+
+
+//-------------------------------------------------
+// Server
+//-------------------------------------------------
+
+StimulusServer::StimulusServer(const char* path, std::vector<GenConfig> mixes, const ServeOptions& options)
+    : socket_path(path), mix_configs(std::move(mixes)), opts(options) {
+
+    for (const GenConfig& config : mix_configs) {
+
+        if (make_gen_tables(config).sampler.count == 0) {
+
+            throw std::invalid_argument("the instruction mix is empty");
+
+        }
+
+    }
+
+    sockaddr_un addr = socket_address(path);
+
+    // A socket left by an earlier run is replaced; any other file is not
+    struct stat st;
+
+    if (::lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+
+        ::unlink(path);
+
+    }
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listen_fd < 0) {
+
+        throw io_error("socket failed");
+
+    }
+
+    if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, 16) < 0) {
+
+        std::system_error error = io_error(std::string("cannot listen on ") + path);
+        ::close(listen_fd);
+        throw error;
+
+    }
+
+}
+
+
+
+StimulusServer::~StimulusServer() {
+
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+
+}
+
+
+
+void StimulusServer::run() {
+
+    while (!stopping.load()) {
+
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+
+        if (fd < 0) {
+
+            int err = errno;
+
+            if (stopping.load()) {
+
+                break;
+
+            }
+
+            // Out of descriptors or memory: wait for clients to leave
+            if (err != EINTR && err != ECONNABORTED) {
+
+                std::cerr << "serve: accept: " << std::strerror(err) << ", retrying\n";
+                reap_clients();
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            }
+
+            continue;
+
+        }
+
+        reap_clients();
+
+        // The thread looks itself up by fd, so it is registered under the lock
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        clients.push_back({fd, std::thread(), false});
+        clients.back().thread = std::thread(&StimulusServer::serve_client, this, fd);
+
+    }
+
+    // Wake every client blocked in recv() or send(), then join them all
+    std::list<Client> remaining;
+
+    {
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+
+        for (Client& client : clients) {
+
+            if (!client.done) {
+
+                ::shutdown(client.fd, SHUT_RDWR);
+
+            }
+
+        }
+
+        remaining.swap(clients);
+
+    }
+
+    for (Client& client : remaining) {
+
+        client.thread.join();
+
+    }
+
+}
+
+
+
+void StimulusServer::reap_clients() {
+
+    std::list<Client> finished;
+
+    {
+
+        std::lock_guard<std::mutex> lock(clients_mutex);
+
+        for (auto it = clients.begin(); it != clients.end(); ) {
+
+            auto next = std::next(it);
+
+            if (it->done) {
+
+                finished.splice(finished.end(), clients, it);
+
+            }
+
+            it = next;
+
+        }
+
+    }
+
+    for (Client& client : finished) {
+
+        client.thread.join();
+
+    }
+
+}
+
+
+
+void StimulusServer::stop() {
+
+    stopping.store(true);
+    ::shutdown(listen_fd, SHUT_RDWR);
+
+}
+
+
+
+void StimulusServer::serve_client(int fd) {
+
+    // The previous request's stream and the index after its reply
+    bool served = false;
+    uint32_t mix = 0;
+    uint64_t seed = 0;
+    uint64_t next = 0;
+
+    // Prefetch ring, and the stream it is on
+    std::unique_ptr<Prefetcher> prefetch;
+    uint32_t prefetch_mix = 0;
+    uint64_t prefetch_seed = 0;
+
+    // Stream for requests answered on this thread
+    std::unique_ptr<ShardedStream> direct;
+    uint32_t direct_mix = 0;
+
+    std::vector<uint32_t> reply;
+    unsigned char requests[SERVE_REQUEST_SIZE * REQUEST_BATCH];
+    size_t have = 0;
+
+    try {
+
+        for (bool open = true; open; ) {
+
+            // Everything already queued arrives in one recv()
+            ssize_t n = ::recv(fd, requests + have, sizeof(requests) - have, 0);
+
+            if (n < 0 && errno == EINTR) {
+
+                continue;
+
+            }
+
+            if (n <= 0) {
+
+                break;
+
+            }
+
+            have += static_cast<size_t>(n);
+            size_t whole = have / SERVE_REQUEST_SIZE;
+            size_t words = 0;
+
+            for (size_t k = 0; k < whole; ++k) {
+
+                const unsigned char* p = requests + k * SERVE_REQUEST_SIZE;
+                ServeRequest request{static_cast<uint32_t>(get_le(p, 4)), static_cast<uint32_t>(get_le(p + 4, 4)),
+                                     get_le(p + 8, 8), get_le(p + 16, 8)};
+
+                if (request.count > MAX_SERVE_COUNT || request.mix >= mix_configs.size()) {
+
+                    open = false;
+                    break;
+
+                }
+
+                if (words > 0 && words + request.count > MAX_REPLY_WORDS) {
+
+                    send_all(fd, reply.data(), 4 * words);
+                    words = 0;
+
+                }
+
+                if (reply.size() < words + request.count) {
+
+                    reply.resize(words + request.count);
+
+                }
+
+                // The prefetch serves the words it holds; a request right
+                // after the previous one (re)starts it there, and anything
+                // else is generated here without touching it
+                bool continues = served && request.mix == mix && request.seed == seed && request.start == next;
+                bool prefetched = prefetch && request.mix == prefetch_mix && request.seed == prefetch_seed &&
+                                  request.start == prefetch->position();
+                GenConfig config = mix_configs[request.mix];
+                config.seed = request.seed;
+
+                if (!prefetched && continues) {
+
+                    prefetch.reset();
+                    prefetch = std::make_unique<Prefetcher>(config, request.start, opts);
+                    prefetch_mix = request.mix;
+                    prefetch_seed = request.seed;
+                    prefetched = true;
+
+                }
+
+                if (prefetched) {
+
+                    prefetch->take(reply.data() + words, request.count);
+
+                } else {
+
+                    if (!direct || direct_mix != request.mix || direct->config().seed != request.seed) {
+
+                        direct = std::make_unique<ShardedStream>(config);
+                        direct_mix = request.mix;
+
+                    }
+
+                    if (direct->position() != request.start) {
+
+                        direct->seek(request.start);
+
+                    }
+
+                    direct->generate(reply.data() + words, request.count);
+
+                }
+
+                served = true;
+                mix = request.mix;
+                seed = request.seed;
+                next = request.start + request.count;
+                to_wire_order(reply.data() + words, request.count);
+                words += request.count;
+
+            }
+
+            send_all(fd, reply.data(), 4 * words);
+
+            // Keep a partial request for the next recv()
+            have -= whole * SERVE_REQUEST_SIZE;
+            std::memmove(requests, requests + whole * SERVE_REQUEST_SIZE, have);
+
+        }
+
+    } catch (const std::exception&) {
+
+        // The client went away mid-reply; nothing else depends on it
+
+    }
+
+    // Stop the producer before reporting back, so a finished client holds
+    // no threads but its own
+    prefetch.reset();
+
+    std::lock_guard<std::mutex> lock(clients_mutex);
+    auto self = std::find_if(clients.begin(), clients.end(), [&](const Client& c) { return c.fd == fd && !c.done; });
+    self->done = true;
+    ::close(fd);
+
+}
+
+
+//-------------------------------------------------
+// Client
+//-------------------------------------------------
+
+int connect_server(const char* path) {
+
+    sockaddr_un addr = socket_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0) {
+
+        throw io_error("socket failed");
+
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+
+        std::system_error error = io_error(std::string("cannot connect to ") + path);
+        ::close(fd);
+        throw error;
+
+    }
+
+    return fd;
+
+}
+
+
+
+void request_words(int fd, const ServeRequest& request, uint32_t* out) {
+
+    unsigned char bytes[SERVE_REQUEST_SIZE];
+    put_le(bytes, request.count, 4);
+    put_le(bytes + 4, request.mix, 4);
+    put_le(bytes + 8, request.seed, 8);
+    put_le(bytes + 16, request.start, 8);
+
+    send_all(fd, bytes, sizeof(bytes));
+    recv_all(fd, out, 4 * size_t{request.count});
+    to_wire_order(out, request.count);
+
+}
+
+
+//-------------------------------------------------
+// Verification
+//-------------------------------------------------
+
+bool verify_server(const GenConfig& config, std::ostream& log) {
+
+    // The socket goes in a private directory under $TMPDIR (or /tmp)
+    const char* tmp = std::getenv("TMPDIR");
+    std::string dir = std::string(tmp && *tmp ? tmp : "/tmp") + "/gen_rand_serve_XXXXXX";
+
+    if (::mkdtemp(&dir[0]) == nullptr) {
+
+        log << "  server: cannot create a directory in " << (tmp && *tmp ? tmp : "/tmp") << ": " << std::strerror(errno) << "\n";
+        return false;
+
+    }
+
+    // Declared before the server, so it is removed after the socket
+    struct RemoveDir {
+        std::string path;
+        ~RemoveDir() { ::rmdir(path.c_str()); }
+    } remove_dir{dir};
+
+    std::string path = dir + "/serve.sock";
+
+    // Mix 1 differs from mix 0 in its weights and register constraints
+    GenConfig other = config;
+    other.weights[ID_ADDI] = 40;
+    other.regs.hot_regs = 0x60;
+    other.regs.hot_percent = 30;
+
+    StimulusServer server(path.c_str(), {config, other}, {4096, 4});
+    std::thread thread([&]() { server.run(); });
+    uint64_t failures = 0;
+    uint64_t requests = 0;
+    double seconds = 0;
+    uint64_t round_trips = 0;
+    double round_trip_seconds = 0;
+    uint64_t jumps = 0;
+    double jump_seconds = 0;
+
+    auto check = [&](uint32_t mix, uint64_t seed, uint64_t start, const std::vector<uint32_t>& got, const char* what) {
+
+        GenConfig expected_config = mix ? other : config;
+        expected_config.seed = seed;
+        std::vector<uint32_t> expected(got.size());
+        ShardedStream stream(expected_config);
+        stream.seek(start);
+        stream.generate(expected.data(), expected.size());
+
+        if (got != expected) {
+
+            if (failures++ < 8) {
+
+                log << "  server: " << what << " reply at " << start << " (mix " << mix << ", seed " << seed << ") differs\n";
+
+            }
+
+        }
+
+    };
+
+    try {
+
+        int fd = connect_server(path.c_str());
+
+        // In order, 4 KB at a time across several shards: served from the prefetch ring
+        std::vector<uint32_t> got(150 * 1024);
+        auto begin = std::chrono::steady_clock::now();
+
+        for (size_t k = 0; k < 150; ++k) {
+
+            request_words(fd, {1024, 0, config.seed, 1024 * k}, got.data() + 1024 * k);
+            ++requests;
+
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        check(0, config.seed, 0, got, "in-order");
+
+        // Once the ring has caught up, small requests that drain no block
+        // cost only the socket round trip
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        got.assign(64 * 16, 0);
+        begin = std::chrono::steady_clock::now();
+
+        for (size_t k = 0; k < 64; ++k) {
+
+            request_words(fd, {16, 0, config.seed, 150 * 1024 + 16 * k}, got.data() + 16 * k);
+            ++round_trips;
+
+        }
+
+        round_trip_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        check(0, config.seed, 150 * 1024, got, "buffered");
+
+        // Several requests in flight at once, answered in one batch
+        std::vector<unsigned char> burst(8 * SERVE_REQUEST_SIZE);
+
+        for (size_t k = 0; k < 8; ++k) {
+
+            uint64_t fields[] = {1000, 1, 42, 700001 + 1000 * k};
+            put_le(&burst[k * SERVE_REQUEST_SIZE], fields[0], 4);
+            put_le(&burst[k * SERVE_REQUEST_SIZE + 4], fields[1], 4);
+            put_le(&burst[k * SERVE_REQUEST_SIZE + 8], fields[2], 8);
+            put_le(&burst[k * SERVE_REQUEST_SIZE + 16], fields[3], 8);
+
+        }
+
+        got.assign(8000, 0);
+        send_all(fd, burst.data(), burst.size());
+        recv_all(fd, got.data(), 4 * got.size());
+        to_wire_order(got.data(), got.size());
+        check(1, 42, 700001, got, "pipelined");
+
+        // Jumps are answered without the prefetch
+        for (uint64_t start : {uint64_t{5}, uint64_t{3} << 32, uint64_t{65535}}) {
+
+            got.assign(3000, 0);
+            request_words(fd, {3000, 0, 7, start}, got.data());
+            check(0, 7, start, got, "random-access");
+
+        }
+
+        // 4 KB at scattered seeds and starts, none following the one before
+        std::vector<std::vector<uint32_t>> scattered(64, std::vector<uint32_t>(1024));
+        begin = std::chrono::steady_clock::now();
+
+        for (uint64_t k = 0; k < scattered.size(); ++k) {
+
+            request_words(fd, {1024, static_cast<uint32_t>(k & 1), 100 + k % 4, k * 7919 * 1024 + 17}, scattered[k].data());
+            ++jumps;
+
+        }
+
+        jump_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        for (uint64_t k = 0; k < scattered.size(); ++k) {
+
+            check(static_cast<uint32_t>(k & 1), 100 + k % 4, k * 7919 * 1024 + 17, scattered[k], "scattered");
+
+        }
+
+        // An unknown mix ends the session
+        try {
+
+            request_words(fd, {1, 2, 7, 0}, got.data());
+            log << "  server: unknown mix accepted\n";
+            ++failures;
+
+        } catch (const std::system_error&) {
+        }
+
+        ::close(fd);
+
+    } catch (const std::exception& e) {
+
+        log << "  server: " << e.what() << "\n";
+        ++failures;
+
+    }
+
+    server.stop();
+    thread.join();
+
+    log << "server: " << requests << " in-order 4 KB requests, " << seconds / requests * 1e6 << " us each, " << round_trips
+        << " 64-byte from a full ring, " << round_trip_seconds / round_trips * 1e6 << " us each, " << jumps << " random-access, "
+        << jump_seconds / jumps * 1e6 << " us each, " << failures << " failures\n";
+    return failures == 0;
+
+}
@@ -0,0 +1,124 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "generator.h"
+
+//-------------------------------------------------
+// Stimulus Server
+//
+// Long-lived mode for co-simulation harnesses: the generator listens on
+// a Unix-domain stream socket and answers requests for instruction words
+// for as long as it runs. A request is 24 bytes, little-endian:
+//   u32 count   words wanted, at most MAX_SERVE_COUNT
+//   u32 mix     0 for the server's own configuration, k for its k-th
+//               additional mix
+//   u64 seed
+//   u64 start   index of the first instruction in the (seed, mix) stream
+// The reply is count raw little-endian words: the words --format bin
+// writes for that seed, mix and --start. A malformed request closes the
+// connection.
+//
+// A request that does not continue the previous reply is generated on the
+// connection's own thread. Once a client asks for the words right after
+// its previous reply, the connection starts prefetching: a generator
+// thread keeps a ring of blocks filled with the words that follow, so a
+// client reading its stream in order is answered from memory. The
+// generator waits while the ring is full, so a slow client only holds
+// back its own ring. Requests that are already queued on the socket are
+// answered with a single send.
+//
+// Latency, as --self-test reports it on a single-core machine: a request
+// the ring already holds costs the socket round trip, about 5-6 us; a
+// client reading 4 KB at a time in order waits about 24 us, because the
+// prefetch thread generates on the same core (roughly 14 us per 1024
+// words); a 4 KB request at an unrelated position takes about 100 us
+// (seek and generation on the connection's thread). Low microseconds for
+// 4 KB in-order requests needs a spare core for the prefetch thread;
+// random access does not reach it.
+//-------------------------------------------------
+
+struct ServeRequest {
+    uint32_t count;
+    uint32_t mix;
+    uint64_t seed;
+    uint64_t start;
+};
+
+constexpr size_t SERVE_REQUEST_SIZE = 24;
+constexpr uint32_t MAX_SERVE_COUNT = uint32_t{1} << 24;
+
+struct ServeOptions {
+
+    // Words per prefetch block and blocks per connection (1 MB ahead by
+    // default)
+    size_t block_words = 16384;
+    size_t depth = 16;
+
+};
+
+class StimulusServer {
+
+public:
+
+    // Bind and listen on path, replacing a stale socket there; mixes[k]
+    // serves mix id k, its seed replaced by each request's. Throws
+    // std::system_error, or std::invalid_argument for an empty mix.
+    StimulusServer(const char* path, std::vector<GenConfig> mixes, const ServeOptions& options = {});
+
+    // Closes the socket and removes path
+    ~StimulusServer();
+
+    StimulusServer(const StimulusServer&) = delete;
+    StimulusServer& operator=(const StimulusServer&) = delete;
+
+    // Accept clients, one thread each, until stop(); then disconnect them
+    // and join their threads. Failed accepts are logged and retried.
+    void run();
+
+    // Make run() return; callable from any thread
+    void stop();
+
+private:
+
+    struct Client {
+        int fd;
+        std::thread thread;
+        bool done = false;  // fd closed, thread about to return
+    };
+
+    void serve_client(int fd);
+
+    // Join the threads of clients that have disconnected
+    void reap_clients();
+
+    std::string socket_path;
+    std::vector<GenConfig> mix_configs;
+    ServeOptions opts;
+    int listen_fd = -1;
+    std::atomic<bool> stopping{false};
+    std::mutex clients_mutex;
+    std::list<Client> clients;
+
+};
+
+// Client side: connect to a server, and send one request and read its
+// reply into out[0..count). Both throw std::system_error.
+int connect_server(const char* path);
+void request_words(int fd, const ServeRequest& request, uint32_t* out);
+
+// Serve config from a temporary socket and compare in-order, pipelined
+// and out-of-order requests against ShardedStream. Failures are reported
+// to log; returns true if every reply matches.
+bool verify_server(const GenConfig& config, std::ostream& log);
+
+#endif // SERVE_H
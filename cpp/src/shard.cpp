@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "shard.h"
+
+//-------------------------------------------------
+// Function Definitions
+//-------------------------------------------------
+
+unsigned resolve_threads(unsigned threads) {
+
+    if (threads == 0) {
+
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    }
+
+    return threads;
+
+}
+
+
+
+size_t generate_sharded(uint32_t* out, size_t n, const GenConfig& config, unsigned threads, uint64_t first_shard) {
+
+    size_t shard_count = (n + SHARD_SIZE - 1) / SHARD_SIZE;
+    std::atomic<size_t> next_shard{0};
+    std::atomic<size_t> written{0};
+
+    // Each worker claims whole shards until none are left
+    auto worker = [&]() {
+
+        size_t local_written = 0;
+
+        for (size_t s = next_shard.fetch_add(1, std::memory_order_relaxed); s < shard_count;
+             s = next_shard.fetch_add(1, std::memory_order_relaxed)) {
+
+            size_t begin = s * SHARD_SIZE;
+            size_t len = std::min(SHARD_SIZE, n - begin);
+
+            Rng rng(config.rng, config.seed, first_shard + s);
+            local_written += generate_batch(out + begin, len, config, rng);
+
+        }
+
+        written.fetch_add(local_written, std::memory_order_relaxed);
+
+    };
+
+    // Never start more threads than there are shards
+    threads = static_cast<unsigned>(std::min<size_t>(resolve_threads(threads), shard_count));
+
+    if (threads <= 1) {
+
+        worker();
+        return written.load();
+
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+
+    for (unsigned t = 1; t < threads; ++t) {
+
+        pool.emplace_back(worker);
+
+    }
+
+    worker();
+
+    for (std::thread& th : pool) {
+
+        th.join();
+
+    }
+
+    return written.load();
+
+}
+
+
+
+Rng stream_rng_at(const GenConfig& config, uint64_t index) {
+
+    Rng rng(config.rng, config.seed, index / SHARD_SIZE);
+    GenTables tables = make_gen_tables(config);
+
+    // The scoreboard depends on the records themselves, so hazard shaping
+    // rebuilds it by regenerating the shard's earlier records
+    if (tables.hazards.active) {
+
+        std::vector<InstrRecord> scratch(index % SHARD_SIZE);
+        generate_records(scratch.data(), scratch.size(), config, rng);
+        return rng;
+
+    }
+
+    // Every instruction takes the same number of draws (see draw_instr())
+    uint64_t draws = (index % SHARD_SIZE) * draws_per_instr(tables);
+
+    switch (rng.kind()) {
+
+        case RngKind::XOSHIRO:
+
+            for (uint64_t i = 0; i < draws; ++i) {
+
+                rng.xoshiro().next();
+
+            }
+
+            break;
+
+        case RngKind::PHILOX:
+            rng.philox().seek(draws);
+            break;
+
+    }
+
+    return rng;
+
+}
+
+
+
+InstrRecord record_at(const GenConfig& config, uint64_t index) {
+
+    Rng rng = stream_rng_at(config, index);
+    InstrRecord rec{};
+    generate_records(&rec, 1, config, rng);
+    return rec;
+
+}
+
+
+
+ShardedStream::ShardedStream(const GenConfig& config) : cfg(config), rng(config.rng, config.seed, 0) {}
+
+
+
+void ShardedStream::seek(uint64_t index) {
+
+    rng = stream_rng_at(cfg, index);
+    pos = index;
+
+}
+
+
+
+size_t ShardedStream::generate(uint32_t* out, size_t n) {
+
+    size_t done = 0;
+
+    while (done < n) {
+
+        // Switch to the next shard's stream on every shard boundary
+        size_t offset = static_cast<size_t>(pos % SHARD_SIZE);
+
+        if (offset == 0 && pos != 0) {
+
+            rng = Rng(cfg.rng, cfg.seed, pos / SHARD_SIZE);
+
+        }
+
+        size_t len = std::min(n - done, SHARD_SIZE - offset);
+        size_t written = generate_batch(out + done, len, cfg, rng);
+
+        if (written == 0) {
+
+            break;
+
+        }
+
+        done += written;
+        pos += written;
+
+    }
+
+    return done;
+
+}
+
+
+
+size_t ShardedStream::generate(uint32_t* out, size_t n, unsigned threads) {
+
+    size_t done = 0;
+
+    if (threads > 1) {
+
+        // Finish the current shard here, then run whole shards in parallel
+        size_t head = std::min(n, static_cast<size_t>((SHARD_SIZE - pos % SHARD_SIZE) % SHARD_SIZE));
+
+        if (head > 0 && (done = generate(out, head)) < head) {
+
+            return done;
+
+        }
+
+        size_t whole = (n - done) / SHARD_SIZE * SHARD_SIZE;
+
+        if (whole > 0) {
+
+            size_t written = generate_sharded(out + done, whole, cfg, threads, pos / SHARD_SIZE);
+            done += written;
+            pos += written;
+
+            if (written < whole) {
+
+                return done;
+
+            }
+
+        }
+
+    }
+
+    // The tail; generate() re-seeds for the shard it starts in
+    return done + generate(out + done, n - done);
+
+}
@@ -0,0 +1,69 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "generator.h"
+
+//-------------------------------------------------
+// Sharded Multi-Threaded Generation
+//
+// The instruction stream is cut into fixed-size shards. Shard k is always
+// generated by Rng(config.rng, config.seed, k), whichever thread runs it, so
+// the output is bit-identical for any thread count.
+//-------------------------------------------------
+
+constexpr size_t SHARD_SIZE = size_t{1} << 16;
+
+// Number of worker threads to use for a requested count (0 = all cores)
+unsigned resolve_threads(unsigned threads);
+
+// Fill out[0..n) with instructions [first_shard * SHARD_SIZE, ... + n) of
+// the stream described by config, using up to `threads` workers. Each worker
+// writes only to the disjoint regions of the shards it claims. Returns the
+// number of words written.
+size_t generate_sharded(uint32_t* out, size_t n, const GenConfig& config, unsigned threads, uint64_t first_shard = 0);
+
+// Generator positioned at instruction `index` of config's stream: the
+// engine of the index's shard, advanced past the shard's earlier
+// instructions. Philox seeks in O(1); xoshiro replays at most
+// SHARD_SIZE - 1 instructions' worth of draws. With hazard shaping the
+// scoreboard is rebuilt by regenerating up to SHARD_SIZE - 1 records.
+Rng stream_rng_at(const GenConfig& config, uint64_t index);
+
+// Instruction `index` of config's stream, as generate_sharded() draws it
+InstrRecord record_at(const GenConfig& config, uint64_t index);
+
+// Sequential cursor over the same sharded stream, for callers that pull
+// instructions a batch at a time (DPI, bindings). Reading n words at a time
+// yields exactly the words generate_sharded() produces for the same config.
+class ShardedStream {
+
+public:
+
+    explicit ShardedStream(const GenConfig& config);
+
+    size_t generate(uint32_t* out, size_t n);
+
+    // As above, handing whole shards to up to `threads` workers; the words
+    // are the same for any thread count
+    size_t generate(uint32_t* out, size_t n, unsigned threads);
+
+    // Continue from instruction `index` (see stream_rng_at())
+    void seek(uint64_t index);
+
+    // Index of the next instruction in the stream
+    uint64_t position() const { return pos; }
+
+    const GenConfig& config() const { return cfg; }
+
+private:
+
+    GenConfig cfg;
+    Rng rng;
+    uint64_t pos = 0;
+
+};
+
+#endif // SHARD_H
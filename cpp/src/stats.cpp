@@ -0,0 +1,257 @@
+#include "stats.h"
+
+#if GEN_STATS
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <signal.h>
+
+//-------------------------------------------------
+// Per-Thread Blocks
+//-------------------------------------------------
+
+namespace {
+
+std::mutex registry_mutex;
+std::mutex dump_mutex;
+const char* dump_path = nullptr;
+
+// Never freed, so blocks outlive their threads and exit-time dumps
+std::vector<std::unique_ptr<ThreadStats>>& registry() {
+
+    static auto* blocks = new std::vector<std::unique_ptr<ThreadStats>>();
+    return *blocks;
+
+}
+
+thread_local StageTimer* active_timer = nullptr;
+
+void dump_to_path() {
+
+    std::lock_guard<std::mutex> lock(dump_mutex);
+
+    if (dump_path) {
+
+        std::ofstream file(dump_path);
+        stats_dump(file);
+
+    } else {
+
+        stats_dump(std::cerr);
+
+    }
+
+}
+
+} // namespace
+
+
+
+ThreadStats& thread_stats() {
+
+    thread_local ThreadStats* local = []() {
+
+        auto block = std::make_unique<ThreadStats>();
+        ThreadStats* p = block.get();
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry().push_back(std::move(block));
+        return p;
+
+    }();
+
+    return *local;
+
+}
+
+
+
+void stats_record_batch(uint64_t ns) {
+
+    size_t bucket = static_cast<size_t>(63 - __builtin_clzll(ns | 1));
+    stats_bump(thread_stats().batch_latency[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1], 1);
+
+}
+
+
+
+StageTimer::StageTimer(Stage stage, uint64_t instrs) : stage(stage), instrs(instrs), outer(active_timer) {
+
+    start = stats_ticks();
+
+    // Stop the enclosing stage's clock while this one runs
+    if (outer) {
+
+        outer->elapsed += start - outer->start;
+
+    }
+
+    active_timer = this;
+
+}
+
+
+
+StageTimer::~StageTimer() {
+
+    uint64_t now = stats_ticks();
+    stats_add_stage(thread_stats(), stage, elapsed + (now - start), instrs);
+
+    active_timer = outer;
+
+    if (outer) {
+
+        outer->start = now;
+
+    }
+
+}
+
+
+//-------------------------------------------------
+// Export
+//-------------------------------------------------
+
+void stats_dump(std::ostream& out) {
+
+    static const char* const stage_names[STAGE_COUNT] = {"select", "encode", "text", "output"};
+
+    uint64_t instrs[INSTR_COUNT] = {};
+    uint64_t stage_ticks[STAGE_COUNT] = {};
+    uint64_t stage_instrs[STAGE_COUNT] = {};
+    uint64_t latency[LATENCY_BUCKETS] = {};
+    size_t threads;
+
+    // Sum every thread's block; counters are read while they may still move
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        threads = registry().size();
+
+        for (const std::unique_ptr<ThreadStats>& block : registry()) {
+
+            for (size_t i = 0; i < INSTR_COUNT; ++i) {
+
+                instrs[i] += block->instrs[i].load(std::memory_order_relaxed);
+
+            }
+
+            for (size_t i = 0; i < STAGE_COUNT; ++i) {
+
+                stage_ticks[i] += block->stage_ticks[i].load(std::memory_order_relaxed);
+                stage_instrs[i] += block->stage_instrs[i].load(std::memory_order_relaxed);
+
+            }
+
+            for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+
+                latency[i] += block->batch_latency[i].load(std::memory_order_relaxed);
+
+            }
+
+        }
+    }
+
+    uint64_t total = 0;
+
+    for (uint64_t n : instrs) {
+
+        total += n;
+
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char* tick_unit = "tsc";
+#else
+    const char* tick_unit = "ns";
+#endif
+
+    out << "{\n  \"threads\": " << threads << ",\n  \"instructions\": " << total << ",\n  \"tick_unit\": \"" << tick_unit << "\",\n";
+
+    out << "  \"mnemonics\": {";
+
+    for (size_t i = 0; i < INSTR_COUNT; ++i) {
+
+        out << (i ? ", " : "") << "\"" << instr_table[i].mnemonic << "\": " << instrs[i];
+
+    }
+
+    out << "},\n  \"stages\": {\n";
+
+    for (size_t i = 0; i < STAGE_COUNT; ++i) {
+
+        out << "    \"" << stage_names[i] << "\": {\"ticks\": " << stage_ticks[i] << ", \"instructions\": " << stage_instrs[i]
+            << ", \"ticks_per_instr\": " << (stage_instrs[i] ? static_cast<double>(stage_ticks[i]) / stage_instrs[i] : 0.0)
+            << "}" << (i + 1 < STAGE_COUNT ? "," : "") << "\n";
+
+    }
+
+    // Only the occupied buckets, by lower bound in ns
+    out << "  },\n  \"batch_latency_ns\": {";
+    bool first = true;
+
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+
+        if (latency[i] != 0) {
+
+            out << (first ? "" : ", ") << "\"" << (uint64_t{1} << i) << "\": " << latency[i];
+            first = false;
+
+        }
+
+    }
+
+    out << "}\n}\n";
+    out.flush();
+
+}
+
+
+
+void stats_install(const char* path) {
+
+    dump_path = path;
+    std::atexit(dump_to_path);
+
+    // Threads started later inherit the blocked mask, so SIGUSR1 is only
+    // ever taken by the dump thread, outside any signal handler
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+
+    std::thread([set]() {
+
+        for (;;) {
+
+            int sig;
+
+            if (sigwait(&set, &sig) == 0) {
+
+                dump_to_path();
+
+            }
+
+        }
+
+    }).detach();
+
+}
+
+#else
+
+void stats_install(const char*) {}
+
+void stats_dump(std::ostream& out) {
+
+    out << "{\"enabled\": false}\n";
+
+}
+
+#endif // GEN_STATS
@@ -0,0 +1,166 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "instr_table.h"
+
+#ifndef GEN_STATS
+#define GEN_STATS 0
+#endif
+
+#if GEN_STATS
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+//-------------------------------------------------
+// Hot-Path Statistics
+//
+// Compiled in only with GEN_STATS=1 (CMake option GEN_STATS); otherwise
+// every hook below is an empty inline function. Each thread counts into
+// its own cache-line aligned block with plain relaxed stores, so the hot
+// path has no atomics read-modify-writes and no shared lines. A dump sums
+// the blocks of all threads, including threads that have exited.
+//
+// Stage times are in timestamp-counter ticks on x86, nanoseconds elsewhere.
+// The batch generator times its stages per block of instructions rather
+// than per instruction. Random words are drawn as the record needs them,
+// so they are part of the select stage.
+//-------------------------------------------------
+
+enum class Stage : uint8_t {
+    SELECT,         // random words; instruction, register and immediate selection
+    ENCODE,         // machine-word encoding
+    TEXT,           // assembly and $readmem text rendering
+    OUTPUT          // write() system calls
+};
+
+constexpr size_t STAGE_COUNT = 4;
+
+// Batch latency histogram: bucket b counts batches of [2^b, 2^(b+1)) ns
+constexpr size_t LATENCY_BUCKETS = 40;
+
+// Dump the statistics as JSON to path (stderr when null) at exit and on
+// every SIGUSR1. Call before starting any threads. No-op without GEN_STATS.
+void stats_install(const char* path);
+
+// Write the JSON document for all threads so far
+void stats_dump(std::ostream& out);
+
+constexpr bool stats_enabled() { return GEN_STATS != 0; }
+
+#if GEN_STATS
+
+struct alignas(64) ThreadStats {
+
+    std::atomic<uint64_t> instrs[INSTR_COUNT];
+    std::atomic<uint64_t> stage_ticks[STAGE_COUNT];
+    std::atomic<uint64_t> stage_instrs[STAGE_COUNT];
+    std::atomic<uint64_t> batch_latency[LATENCY_BUCKETS];
+
+};
+
+// Calling thread's block, registered on first use
+ThreadStats& thread_stats();
+
+// Single-writer counter update: a plain load and store, no lock prefix
+inline void stats_bump(std::atomic<uint64_t>& counter, uint64_t n) {
+
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+
+}
+
+inline uint64_t stats_ticks() {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+
+}
+
+inline void stats_add_stage(ThreadStats& stats, Stage stage, uint64_t ticks, uint64_t instrs) {
+
+    stats_bump(stats.stage_ticks[static_cast<size_t>(stage)], ticks);
+    stats_bump(stats.stage_instrs[static_cast<size_t>(stage)], instrs);
+
+}
+
+// Count the instructions of a block of records. Four interleaved tallies
+// keep runs of one id from serialising on a single counter.
+inline void stats_count_instrs(ThreadStats& stats, const InstrRecord* records, size_t n) {
+
+    uint32_t tally[4][INSTR_COUNT] = {};
+
+    for (size_t k = 0; k < n; ++k) {
+
+        ++tally[k & 3][records[k].id];
+
+    }
+
+    for (size_t id = 0; id < INSTR_COUNT; ++id) {
+
+        stats_bump(stats.instrs[id], uint64_t{tally[0][id]} + tally[1][id] + tally[2][id] + tally[3][id]);
+
+    }
+
+}
+
+void stats_record_batch(uint64_t ns);
+
+// Times a stage over its scope. Nested timers pause the enclosing one, so
+// e.g. a flush inside text rendering is charged to OUTPUT only.
+class StageTimer {
+
+public:
+
+    explicit StageTimer(Stage stage, uint64_t instrs = 0);
+    ~StageTimer();
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+
+    Stage stage;
+    uint64_t instrs;
+    uint64_t start;
+    uint64_t elapsed = 0;
+    StageTimer* outer;
+
+};
+
+#else
+
+struct ThreadStats {};
+
+inline ThreadStats& thread_stats() {
+
+    static ThreadStats none;
+    return none;
+
+}
+
+inline uint64_t stats_ticks() { return 0; }
+inline void stats_add_stage(ThreadStats&, Stage, uint64_t, uint64_t) {}
+inline void stats_count_instrs(ThreadStats&, const InstrRecord*, size_t) {}
+inline void stats_record_batch(uint64_t) {}
+
+class StageTimer {
+
+public:
+
+    explicit StageTimer(Stage, uint64_t = 0) {}
+
+};
+
+#endif // GEN_STATS
+
+#endif // STATS_H
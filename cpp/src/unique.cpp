@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "unique.h"
+#include "decoder.h"
+
+//-------------------------------------------------
+// Helpers
+//-------------------------------------------------
+
+namespace {
+
+// Registers each format encodes
+struct FieldLayout {
+    bool rd;
+    bool rs1;
+    bool rs2;
+};
+
+FieldLayout field_layout(Format format) {
+
+    switch (format) {
+
+        case Format::R: return {true, true, true};
+        case Format::I: return {true, true, false};
+        case Format::S: return {false, true, true};
+        case Format::B: return {false, true, true};
+        case Format::U: return {true, false, false};
+        case Format::J: return {true, false, false};
+
+    }
+
+    return {false, false, false};
+
+}
+
+// Branch and jump offsets are even
+int32_t imm_step(const InstrDesc& desc) {
+
+    return (desc.format == Format::B || desc.format == Format::J) ? 2 : 1;
+
+}
+
+uint64_t imm_count(const InstrDesc& desc) {
+
+    return static_cast<uint64_t>(static_cast<int64_t>(desc.imm_max) - desc.imm_min) / static_cast<uint64_t>(imm_step(desc)) + 1;
+
+}
+
+// SplitMix64 finalizer, the Feistel round function
+uint64_t mix64(uint64_t z) {
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+
+}
+
+// Independent key for each permutation derived from the seed
+uint64_t derive_key(uint64_t seed, uint64_t salt) {
+
+    uint64_t state = seed ^ mix64(salt + 1);
+    return splitmix64(state);
+
+}
+
+std::vector<uint8_t> enabled_ids(const GenConfig& config) {
+
+    std::vector<uint8_t> ids;
+
+    for (uint8_t id = 0; id < INSTR_COUNT; ++id) {
+
+        if (((config.instr_mask >> id) & 1) && config.weights[id] > 0) {
+
+            ids.push_back(id);
+
+        }
+
+    }
+
+    if (ids.empty()) {
+
+        throw std::invalid_argument("the instruction mix is empty");
+
+    }
+
+    return ids;
+
+}
+
+// Length of the whole sequence, after checking every field space holds
+// per_instr distinct records
+uint64_t unique_total(const std::vector<uint8_t>& ids, uint64_t per_instr) {
+
+    for (uint8_t id : ids) {
+
+        if (per_instr > field_space_size(id)) {
+
+            throw std::invalid_argument(std::string(instr_table[id].mnemonic) + " has only " +
+                                        std::to_string(field_space_size(id)) + " distinct encodings");
+
+        }
+
+    }
+
+    return per_instr * ids.size();
+
+}
+
+} // namespace
+
+
+//-------------------------------------------------
+// Feistel Permutation
+//-------------------------------------------------
+
+FeistelPermutation::FeistelPermutation(uint64_t size, uint64_t key) : domain(size) {
+
+    int bits = 0;
+
+    while (bits < 64 && (uint64_t{1} << bits) < size) {
+
+        ++bits;
+
+    }
+
+    // Two equal halves covering at least `size`; the walk below stays
+    // under four steps on average since the network spans < 4 * size
+    half_bits = std::max(1, (bits + 1) / 2);
+    half_mask = (uint64_t{1} << half_bits) - 1;
+
+    for (uint64_t& k : keys) {
+
+        k = splitmix64(key);
+
+    }
+
+}
+
+
+
+uint64_t FeistelPermutation::operator()(uint64_t index) const {
+
+    // Cycle-walking: a permutation of the larger power-of-two domain,
+    // repeated until the value lands back in [0, size)
+    uint64_t x = index;
+
+    do {
+
+        uint64_t left = x >> half_bits;
+        uint64_t right = x & half_mask;
+
+        for (uint64_t k : keys) {
+
+            uint64_t next = left ^ (mix64(right ^ k) & half_mask);
+            left = right;
+            right = next;
+
+        }
+
+        x = (left << half_bits) | right;
+
+    } while (x >= domain);
+
+    return x;
+
+}
+
+
+//-------------------------------------------------
+// Field Spaces
+//-------------------------------------------------
+
+uint64_t field_space_size(uint8_t id) {
+
+    const InstrDesc& desc = instr_table[id];
+    FieldLayout layout = field_layout(desc.format);
+
+    return (uint64_t{1} << (5 * (layout.rd + layout.rs1 + layout.rs2))) * imm_count(desc);
+
+}
+
+
+
+InstrRecord field_record(uint8_t id, uint64_t index) {
+
+    const InstrDesc& desc = instr_table[id];
+    FieldLayout layout = field_layout(desc.format);
+    InstrRecord rec{id, 0, 0, 0, 0};
+
+    if (layout.rd) {
+
+        rec.rd = static_cast<uint8_t>(index & 0x1F);
+        index >>= 5;
+
+    }
+
+    if (layout.rs1) {
+
+        rec.rs1 = static_cast<uint8_t>(index & 0x1F);
+        index >>= 5;
+
+    }
+
+    if (layout.rs2) {
+
+        rec.rs2 = static_cast<uint8_t>(index & 0x1F);
+        index >>= 5;
+
+    }
+
+    rec.imm = static_cast<int32_t>(desc.imm_min + static_cast<int64_t>(index) * imm_step(desc));
+    return rec;
+
+}
+
+
+
+uint64_t field_index(const InstrRecord& rec) {
+
+    const InstrDesc& desc = instr_table[rec.id];
+    FieldLayout layout = field_layout(desc.format);
+    uint64_t index = static_cast<uint64_t>(static_cast<int64_t>(rec.imm) - desc.imm_min) / static_cast<uint64_t>(imm_step(desc));
+
+    // Most significant field first, the reverse of field_record()
+    if (layout.rs2) {
+
+        index = index << 5 | (rec.rs2 & 0x1Fu);
+
+    }
+
+    if (layout.rs1) {
+
+        index = index << 5 | (rec.rs1 & 0x1Fu);
+
+    }
+
+    if (layout.rd) {
+
+        index = index << 5 | (rec.rd & 0x1Fu);
+
+    }
+
+    return index;
+
+}
+
+
+//-------------------------------------------------
+// Unique Stream
+//-------------------------------------------------
+
+UniqueStream::UniqueStream(const GenConfig& config, uint64_t per_instr)
+    : ids(enabled_ids(config)), order(unique_total(ids, per_instr), derive_key(config.seed, 0)) {
+
+    fields.reserve(ids.size());
+
+    for (uint8_t id : ids) {
+
+        fields.emplace_back(field_space_size(id), derive_key(config.seed, uint64_t{id} + 1));
+
+    }
+
+}
+
+
+
+InstrRecord UniqueStream::at(uint64_t k) const {
+
+    // A random slot of the sequence picks the instruction and which of its
+    // first per_instr field indices to use
+    uint64_t slot = order(k);
+    size_t which = static_cast<size_t>(slot % ids.size());
+
+    return field_record(ids[which], fields[which](slot / ids.size()));
+
+}
+
+
+
+size_t UniqueStream::generate(InstrRecord* out, size_t n) {
+
+    size_t count = static_cast<size_t>(std::min<uint64_t>(n, size() - pos));
+
+    for (size_t i = 0; i < count; ++i) {
+
+        out[i] = at(pos++);
+
+    }
+
+    return count;
+
+}
+
+
+//-------------------------------------------------
+// Dedup Filter
+//-------------------------------------------------
+
+DedupFilter::DedupFilter(uint64_t instr_mask) {
+
+    uint64_t total = 0;
+
+    for (uint8_t id = 0; id < INSTR_COUNT; ++id) {
+
+        offset[id] = total;
+        total += ((instr_mask >> id) & 1) ? field_space_size(id) : 0;
+
+    }
+
+    bits.assign((total + 63) / 64, 0);
+
+}
+
+
+
+bool DedupFilter::insert(const InstrRecord& rec) {
+
+    uint64_t bin = offset[rec.id] + field_index(canonical_record(rec));
+    uint64_t mask = uint64_t{1} << (bin & 63);
+    uint64_t& word = bits[bin >> 6];
+
+    if (word & mask) {
+
+        return false;
+
+    }
+
+    word |= mask;
+    return true;
+
+}
+
+
+
+//-------------------------------------------------
+// Verification
+//-------------------------------------------------
+
+bool verify_unique_stream(const GenConfig& config, uint64_t per_instr, std::ostream& log) {
+
+    UniqueStream stream(config, per_instr);
+    DedupFilter filter(config.instr_mask);
+    uint64_t failures = 0;
+
+    for (uint64_t k = 0; k < stream.size(); ++k) {
+
+        InstrRecord rec = stream.at(k);
+        InstrRecord back = field_record(rec.id, field_index(rec));
+
+        if (!filter.insert(rec) || std::memcmp(&back, &rec, sizeof(rec)) != 0) {
+
+            if (failures++ < 8) {
+
+                log << "  unique stream: record " << k << " (" << format_instr(rec) << ") repeats or does not round-trip\n";
+
+            }
+
+        }
+
+    }
+
+    log << "unique stream: " << stream.size() << " records, " << failures << " failures\n";
+    return failures == 0;
+
+}
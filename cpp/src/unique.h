@@ -0,0 +1,112 @@
+#ifndef UNIQUE_H
+#define UNIQUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "generator.h"
+
+//-------------------------------------------------
+// Duplicate-Free Generation
+//
+// The field space of an instruction is the set of its canonical records
+// (see canonical_record()): every combination of the registers its format
+// encodes and of the immediates in [imm_min, imm_max]. It is numbered in
+// mixed radix, rd + 32 * (rs1 + 32 * (rs2 + 32 * imm_index)) with unused
+// fields left out, so a record and its index convert both ways in O(1).
+//
+// UniqueStream walks a keyed Feistel permutation of each field space, so
+// the first N indices of an instruction give N distinct encodings by
+// construction, with no memory per instruction. DedupFilter is a dense
+// bitmap over the same numbering, for streams (e.g. with register
+// constraints) whose records cannot be enumerated that way.
+//-------------------------------------------------
+
+// Keyed pseudo-random bijection on [0, size): a balanced Feistel network on
+// the next even power of two, cycle-walked back into range
+class FeistelPermutation {
+
+public:
+
+    FeistelPermutation(uint64_t size, uint64_t key);
+
+    uint64_t operator()(uint64_t index) const;
+
+    uint64_t size() const { return domain; }
+
+private:
+
+    static constexpr int ROUNDS = 6;
+
+    uint64_t domain;
+    int half_bits;
+    uint64_t half_mask;
+    uint64_t keys[ROUNDS];
+
+};
+
+// Number of canonical records of instr_table[id]
+uint64_t field_space_size(uint8_t id);
+
+// Canonical record number `index` of an instruction's field space, and the
+// number of a record (fields the format does not encode are ignored)
+InstrRecord field_record(uint8_t id, uint64_t index);
+uint64_t field_index(const InstrRecord& rec);
+
+// per_instr distinct records of every instruction config enables (mask
+// bit set, positive weight), in a keyed random order. Record k is computed
+// directly in O(1), so any position can be regenerated from (config, k).
+// Register constraints are not applied; use DedupFilter for those.
+class UniqueStream {
+
+public:
+
+    // Throws std::invalid_argument if nothing is enabled or per_instr
+    // exceeds the smallest enabled field space
+    UniqueStream(const GenConfig& config, uint64_t per_instr);
+
+    // Total number of records, per_instr per enabled instruction
+    uint64_t size() const { return order.size(); }
+
+    InstrRecord at(uint64_t k) const;
+
+    // Next n records of the sequence (fewer at its end); returns the count
+    size_t generate(InstrRecord* out, size_t n);
+
+private:
+
+    std::vector<uint8_t> ids;
+    std::vector<FeistelPermutation> fields;
+    FeistelPermutation order;
+    uint64_t pos = 0;
+
+};
+
+// Set of canonical records, one bit per field-space index of every
+// instruction (about 21 MB with all instructions enabled)
+class DedupFilter {
+
+public:
+
+    // Room for the instructions in instr_mask only; records of any other
+    // instruction must not be inserted
+    explicit DedupFilter(uint64_t instr_mask = ALL_INSTRS);
+
+    // Add a record; returns false if an equal encoding was added before
+    bool insert(const InstrRecord& rec);
+
+private:
+
+    uint64_t offset[INSTR_COUNT];
+    std::vector<uint64_t> bits;
+
+};
+
+// Run a UniqueStream of config to its end and require every record to be
+// new to a DedupFilter and to survive field_index() / field_record().
+// Failures are reported to log; returns true if all records pass.
+bool verify_unique_stream(const GenConfig& config, uint64_t per_instr, std::ostream& log);
+
+#endif // UNIQUE_H
@@ -0,0 +1,416 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "decoder.h"
+#include "generator.h"
+#include "mix.h"
+#include "shard.h"
+
+//-------------------------------------------------
+// CPython Extension (module gen_rand_native)
+//
+// Plain C API, no third-party dependencies. A Generator is one stream of
+// the sharded generator, so for a given seed it yields exactly the CLI's
+// words (gen_rand --format bin). Batches are written straight into any
+// writable buffer-protocol object (bytearray, array('I'), numpy uint32)
+// with the GIL released, so Python pays per batch, not per instruction.
+//
+//   import gen_rand_native as g
+//   gen = g.Generator(seed=1, rng="xoshiro", threads=4)
+//   words = gen.generate(1_000_000)     # memoryview, format 'I'
+//   gen.fill(buf)                       # fills len(buf) // 4 words in place
+//   g.disassemble(words[0])
+//-------------------------------------------------
+
+namespace {
+
+struct GeneratorObject {
+    PyObject_HEAD
+    GenConfig config;
+    ShardedStream* stream;
+    unsigned threads;
+    bool busy;
+};
+
+// Generate n words into out without the GIL. Returns false with an
+// exception set if the generator is already running in another thread.
+bool generate_into(GeneratorObject* self, uint32_t* out, size_t n, size_t& written) {
+
+    if (self->busy) {
+
+        PyErr_SetString(PyExc_RuntimeError, "Generator is already generating in another thread");
+        return false;
+
+    }
+
+    self->busy = true;
+
+    Py_BEGIN_ALLOW_THREADS
+    written = self->stream->generate(out, n, self->threads);
+    Py_END_ALLOW_THREADS
+
+    self->busy = false;
+    return true;
+
+}
+
+
+
+int Generator_init(GeneratorObject* self, PyObject* args, PyObject* kwargs) {
+
+    static const char* keywords[] = {"seed", "rng", "instr_mask", "mix", "threads", nullptr};
+
+    unsigned long long seed = 0;
+    const char* rng = "xoshiro";
+    unsigned long long instr_mask = ALL_INSTRS;
+    const char* mix = nullptr;
+    unsigned int threads = 1;
+
+    // fill() and generate() use the stream with the GIL released
+    if (self->busy) {
+
+        PyErr_SetString(PyExc_RuntimeError, "Generator is already generating in another thread");
+        return -1;
+
+    }
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|KsKzI", const_cast<char**>(keywords),
+                                     &seed, &rng, &instr_mask, &mix, &threads)) {
+
+        return -1;
+
+    }
+
+    GenConfig config;
+    config.seed = seed;
+    config.instr_mask = instr_mask & ALL_INSTRS;
+
+    if (std::strcmp(rng, "xoshiro") == 0) {
+
+        config.rng = RngKind::XOSHIRO;
+
+    } else if (std::strcmp(rng, "philox") == 0) {
+
+        config.rng = RngKind::PHILOX;
+
+    } else {
+
+        PyErr_Format(PyExc_ValueError, "unknown rng '%s' (xoshiro or philox)", rng);
+        return -1;
+
+    }
+
+    try {
+
+        if (mix) {
+
+            load_mix_file(mix, config.weights);
+
+        }
+
+        if (make_gen_tables(config).sampler.count == 0) {
+
+            PyErr_SetString(PyExc_ValueError, "the instruction mix is empty");
+            return -1;
+
+        }
+
+        // Built first, so a failure leaves the old stream in place
+        std::unique_ptr<ShardedStream> stream = std::make_unique<ShardedStream>(config);
+        delete self->stream;
+        self->stream = stream.release();
+
+    } catch (const std::bad_alloc&) {
+
+        PyErr_NoMemory();
+        return -1;
+
+    } catch (const std::exception& e) {
+
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return -1;
+
+    }
+
+    self->config = config;
+    self->threads = resolve_threads(threads);
+    return 0;
+
+}
+
+
+
+void Generator_dealloc(GeneratorObject* self) {
+
+    // Heap type: instances hold a reference to it
+    PyTypeObject* type = Py_TYPE(self);
+
+    delete self->stream;
+    self->config.~GenConfig();
+    type->tp_free(reinterpret_cast<PyObject*>(self));
+    Py_DECREF(type);
+
+}
+
+
+
+PyObject* Generator_new(PyTypeObject* type, PyObject*, PyObject*) {
+
+    auto* self = reinterpret_cast<GeneratorObject*>(type->tp_alloc(type, 0));
+
+    if (!self) {
+
+        return nullptr;
+
+    }
+
+    new (&self->config) GenConfig();
+    self->threads = 1;
+    self->busy = false;
+    self->stream = new (std::nothrow) ShardedStream(self->config);
+
+    if (!self->stream) {
+
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+
+    }
+
+    return reinterpret_cast<PyObject*>(self);
+
+}
+
+
+
+// fill(buffer) -> int: fill len(buffer) // 4 words in place
+PyObject* Generator_fill(GeneratorObject* self, PyObject* arg) {
+
+    Py_buffer view;
+
+    if (PyObject_GetBuffer(arg, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) {
+
+        return nullptr;
+
+    }
+
+    if (reinterpret_cast<uintptr_t>(view.buf) % alignof(uint32_t) != 0) {
+
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer is not 4-byte aligned");
+        return nullptr;
+
+    }
+
+    size_t written = 0;
+    bool ok = generate_into(self, static_cast<uint32_t*>(view.buf), static_cast<size_t>(view.len) / 4, written);
+    PyBuffer_Release(&view);
+
+    return ok ? PyLong_FromSize_t(written) : nullptr;
+
+}
+
+
+
+// generate(n) -> memoryview of n words (format 'I') over a new bytearray
+PyObject* Generator_generate(GeneratorObject* self, PyObject* arg) {
+
+    Py_ssize_t n = PyLong_AsSsize_t(arg);
+
+    if (n < 0) {
+
+        if (!PyErr_Occurred()) {
+
+            PyErr_SetString(PyExc_ValueError, "count must be non-negative");
+
+        }
+
+        return nullptr;
+
+    }
+
+    if (n > PY_SSIZE_T_MAX / 4) {
+
+        return PyErr_NoMemory();
+
+    }
+
+    PyObject* bytes = PyByteArray_FromStringAndSize(nullptr, n * 4);
+
+    if (!bytes) {
+
+        return nullptr;
+
+    }
+
+    size_t written = 0;
+
+    if (!generate_into(self, reinterpret_cast<uint32_t*>(PyByteArray_AS_STRING(bytes)), static_cast<size_t>(n), written)) {
+
+        Py_DECREF(bytes);
+        return nullptr;
+
+    }
+
+    PyObject* view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+
+    if (!view) {
+
+        return nullptr;
+
+    }
+
+    PyObject* words = PyObject_CallMethod(view, "cast", "s", "I");
+    Py_DECREF(view);
+    return words;
+
+}
+
+
+
+// reset(): restart the stream from instruction 0
+PyObject* Generator_reset(GeneratorObject* self, PyObject*) {
+
+    if (self->busy) {
+
+        PyErr_SetString(PyExc_RuntimeError, "Generator is already generating in another thread");
+        return nullptr;
+
+    }
+
+    try {
+
+        std::unique_ptr<ShardedStream> stream = std::make_unique<ShardedStream>(self->config);
+        delete self->stream;
+        self->stream = stream.release();
+
+    } catch (const std::bad_alloc&) {
+
+        return PyErr_NoMemory();
+
+    }
+
+    Py_RETURN_NONE;
+
+}
+
+
+
+PyObject* Generator_position(GeneratorObject* self, void*) {
+
+    return PyLong_FromUnsignedLongLong(self->stream->position());
+
+}
+
+
+
+PyMethodDef generator_methods[] = {
+    {"fill", reinterpret_cast<PyCFunction>(Generator_fill), METH_O,
+     "fill(buffer) -> int\n\nFill a writable buffer with len(buffer) // 4 words in place."},
+    {"generate", reinterpret_cast<PyCFunction>(Generator_generate), METH_O,
+     "generate(n) -> memoryview\n\nThe next n words as a memoryview of format 'I'."},
+    {"reset", reinterpret_cast<PyCFunction>(Generator_reset), METH_NOARGS,
+     "reset()\n\nRestart the stream from instruction 0."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyGetSetDef generator_getset[] = {
+    {"position", reinterpret_cast<getter>(Generator_position), nullptr, "Index of the next instruction.", nullptr},
+    {nullptr, nullptr, nullptr, nullptr, nullptr}
+};
+
+PyType_Slot generator_slots[] = {
+    {Py_tp_doc, const_cast<char*>("Generator(seed=0, rng='xoshiro', instr_mask=all, mix=None, threads=1)")},
+    {Py_tp_new, reinterpret_cast<void*>(Generator_new)},
+    {Py_tp_init, reinterpret_cast<void*>(Generator_init)},
+    {Py_tp_dealloc, reinterpret_cast<void*>(Generator_dealloc)},
+    {Py_tp_methods, generator_methods},
+    {Py_tp_getset, generator_getset},
+    {0, nullptr}
+};
+
+PyType_Spec generator_spec = {
+    "gen_rand_native.Generator",
+    sizeof(GeneratorObject),
+    0,
+    Py_TPFLAGS_DEFAULT,
+    generator_slots
+};
+
+
+
+// disassemble(word) -> str
+PyObject* module_disassemble(PyObject*, PyObject* arg) {
+
+    unsigned long word = PyLong_AsUnsignedLongMask(arg);
+
+    if (PyErr_Occurred()) {
+
+        return nullptr;
+
+    }
+
+    std::string text = disassemble(static_cast<uint32_t>(word));
+    return PyUnicode_FromStringAndSize(text.data(), static_cast<Py_ssize_t>(text.size()));
+
+}
+
+
+
+PyMethodDef module_methods[] = {
+    {"disassemble", module_disassemble, METH_O,
+     "disassemble(word) -> str\n\nAssembly text of a machine word, as the CLI prints it."},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    "gen_rand_native",
+    "Native RV32I random instruction generator.",
+    -1,
+    module_methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+
+
+PyMODINIT_FUNC PyInit_gen_rand_native() {
+
+    PyObject* module = PyModule_Create(&module_def);
+
+    if (!module) {
+
+        return nullptr;
+
+    }
+
+    PyObject* generator_type = PyType_FromSpec(&generator_spec);
+
+    // PyModule_AddObject steals the type reference only on success
+    if (!generator_type || PyModule_AddObject(module, "Generator", generator_type) < 0) {
+
+        Py_XDECREF(generator_type);
+        Py_DECREF(module);
+        return nullptr;
+
+    }
+
+    if (PyModule_AddIntConstant(module, "SHARD_SIZE", static_cast<long>(SHARD_SIZE)) < 0) {
+
+        Py_DECREF(module);
+        return nullptr;
+
+    }
+
+    return module;
+
+}
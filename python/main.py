@@ -1,6 +1,16 @@
+import argparse
 import random
+import struct
 import time
 
+# Native C++ engine (gen_rand_native, built by the top-level CMake project).
+# When it is importable the stream comes from it and matches the gen_rand
+# CLI for the same seed; otherwise the pure-Python generators below are used.
+try:
+    import gen_rand_native
+except ImportError:
+    gen_rand_native = None
+
 # Ensures different random sequences every time the program runs
 random.seed(time.time())
 
@@ -615,6 +625,35 @@ def generate_random_instruction():
 # Main Function
 #-------------------------------------------------------
 if __name__ == "__main__":
-    for _ in range(25):
-        asm_code, machine_code = generate_random_instruction()
-        print(asm_code)
+    parser = argparse.ArgumentParser(description="Generate random RV32I instructions")
+    parser.add_argument("--count", type=int, default=25, help="number of instructions")
+    parser.add_argument("--seed", type=int, help="stream seed (the native stream matches gen_rand --seed)")
+    parser.add_argument("--output", help="write raw little-endian words, as gen_rand --format bin, instead of assembly")
+    args = parser.parse_args()
+
+    if gen_rand_native:
+
+        # Batch generation into one buffer; no per-instruction Python work
+        seed = args.seed if args.seed is not None else time.time_ns() & (2**64 - 1)
+        words = gen_rand_native.Generator(seed=seed).generate(args.count)
+
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(words)
+        else:
+            for word in words:
+                print(gen_rand_native.disassemble(word))
+
+    else:
+
+        if args.seed is not None:
+            random.seed(args.seed)
+
+        instrs = [generate_random_instruction() for _ in range(args.count)]
+
+        if args.output:
+            with open(args.output, "wb") as f:
+                f.write(struct.pack(f"<{len(instrs)}I", *(machine_code for _, machine_code in instrs)))
+        else:
+            for asm_code, machine_code in instrs:
+                print(asm_code)